@@ -22,10 +22,292 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+// raw captures grow past 2 GB, make off_t 64 bit on 32 bit targets too
+#if !defined(_FILE_OFFSET_BITS)
+#define _FILE_OFFSET_BITS 64
+#endif
+
 #include "ezal.h"
 
+#include <limits.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+
+#if !defined(EZAL_DISABLE_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#if defined(__SSE2__)
+#define EZAL_BLIT_SSE2 1
+#endif
+#define EZAL_BLIT_AVX2 1
+#endif
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define EZAL_ARCHIVE_MMAP 1
+#endif
+
 // private data structures
 
+// one message in the log ring buffer
+// seq is the slot sequence number used to hand the slot between the
+// producers (any thread calling ezal_log_write) and the writer thread
+struct EZALLogSlot {
+  atomic_size_t seq;
+  int level;
+  unsigned int category;
+  char message[EZAL_LOG_MESSAGE_MAX];
+};
+
+struct EZALLogContext {
+  struct EZALLogSlot ring[EZAL_LOG_RING_SIZE];
+  atomic_size_t write_pos;
+  atomic_size_t read_pos;
+  atomic_uint dropped;
+  atomic_bool running;
+  atomic_uint producers;
+  atomic_bool sleeping;
+  ALLEGRO_THREAD* writer;
+  ALLEGRO_MUTEX* mutex;
+  ALLEGRO_COND* cond;
+  bool initialized;
+};
+
+// one pooled pixel buffer, tightly packed ABGR_8888_LE (RGBA bytes)
+struct EZALCaptureFrame {
+  unsigned char* pixels;
+  unsigned int index;
+  struct EZALCaptureFrame* next;
+};
+
+// the main thread copies frames into buffers taken from free_list and
+// queues them, the workers encode and write them and hand them back
+// everything below mutex is guarded by it
+// raw_file is guarded by file_mutex, so the main thread never waits on
+// a worker writing to disk
+struct EZALCaptureContext {
+  struct EZALCaptureConfig cfg;
+  char path[EZAL_CAPTURE_MAX_PATH];
+  size_t frame_size;
+  FILE* raw_file;
+  ALLEGRO_MUTEX* file_mutex;
+
+  struct EZALCaptureFrame* frames;
+  ALLEGRO_THREAD* workers[EZAL_CAPTURE_MAX_WORKERS];
+  int worker_count;
+
+  bool active;
+
+  ALLEGRO_MUTEX* mutex;
+  ALLEGRO_COND* cond;
+  struct EZALCaptureFrame* free_list;
+  struct EZALCaptureFrame* queue_head;
+  struct EZALCaptureFrame* queue_tail;
+  bool stopping;
+  struct EZALCaptureStats stats;
+};
+
+#define EZAL_TIMER_WHEEL_BITS 8
+#define EZAL_TIMER_WHEEL_SLOTS (1 << EZAL_TIMER_WHEEL_BITS)
+#define EZAL_TIMER_WHEEL_MASK (EZAL_TIMER_WHEEL_SLOTS - 1)
+#define EZAL_TIMER_WHEEL_LEVELS 4
+#define EZAL_TIMER_FIRING_LIST (EZAL_TIMER_WHEEL_LEVELS * EZAL_TIMER_WHEEL_SLOTS)
+#define EZAL_TIMER_LIST_COUNT (EZAL_TIMER_FIRING_LIST + 1)
+#define EZAL_TIMER_INDEX_BITS 20
+#define EZAL_TIMER_INDEX_MASK ((1u << EZAL_TIMER_INDEX_BITS) - 1)
+#define EZAL_TIMER_MAX_TIMERS ((int)EZAL_TIMER_INDEX_MASK)
+
+// timers link to each other by index so the pool can grow with realloc
+// list is the wheel slot (or the firing list) the timer is in, -1 when free
+struct EZALTimerNode {
+  EZALTIMERFPTR fn;
+  void* data;
+  uint64_t expires;
+  unsigned int interval;
+  unsigned int generation;
+  int prev;
+  int next;
+  int list;
+};
+
+// hierarchical timing wheel keyed on the frame tick
+// level 0 holds timers due within 256 ticks, each further level covers
+// 256 times the range of the one below and is cascaded down when the
+// level below wraps around
+struct EZALScheduler {
+  struct EZALTimerNode* nodes;
+  int capacity;
+  int free_head;
+  int pending;
+  uint64_t tick;
+  int heads[EZAL_TIMER_LIST_COUNT];
+  int tails[EZAL_TIMER_LIST_COUNT];
+};
+
+// keep_memory marks memory bitmaps that were created as memory bitmaps on
+// purpose (without ALLEGRO_CONVERT_BITMAP), those are never promoted
+struct EZALBitmapEntry {
+  ALLEGRO_BITMAP* bitmap;
+  size_t bytes;
+  bool keep_memory;
+};
+
+// every bitmap loaded or registered through ezal, entries may be added
+// from any thread so the list is guarded by mutex
+struct EZALBitmapRegistry {
+  ALLEGRO_MUTEX* mutex;
+  struct EZALBitmapEntry* entries;
+  int count;
+  int capacity;
+  unsigned int promoted;
+
+  unsigned int frame_memory_draws;
+  unsigned int memory_draws;
+  unsigned int memory_draw_frames;
+  double last_warning_time;
+};
+
+#define EZAL_NAV_CACHE_WAYS 4
+#define EZAL_NAV_STRAIGHT 10
+#define EZAL_NAV_DIAGONAL 14
+#define EZAL_NAV_PARALLEL_MIN 16
+
+// search state of one cell, only meaningful while visit matches the
+// visit of the search using it
+// heap is the position in the open list, -1 once the cell is closed
+struct EZALNavNode {
+  uint32_t visit;
+  uint32_t g;
+  uint32_t f;
+  int32_t parent;
+  int32_t heap;
+};
+
+// scratch space for one search at a time, sized for the grid once and
+// reused by every search after that
+// bumping visit resets all the nodes without touching them
+struct EZALNavSearch {
+  struct EZALNavNode* nodes;
+  int32_t* open;
+  int open_count;
+  uint32_t visit;
+  unsigned long long expanded;
+};
+
+// start is -1 when the entry is empty, length is EZAL_NAV_NO_PATH for a
+// cached failure
+struct EZALNavCacheEntry {
+  int start;
+  int goal;
+  int length;
+  int capacity;
+  uint32_t last_use;
+  struct EZALNavPoint* points;
+};
+
+// set associative, EZAL_NAV_CACHE_WAYS entries per set
+// every entry owns region_words words of regions, one bit for each
+// region its path goes through
+struct EZALNavCache {
+  struct EZALNavCacheEntry entries[EZAL_NAV_CACHE_SIZE];
+  uint64_t* regions;
+  uint32_t clock;
+};
+
+struct EZALFlowField {
+  struct EZALNavGrid* grid;
+  struct EZALFlowField* next;
+  int goal;
+  unsigned int version;
+  uint32_t* distance;
+  unsigned char* direction;
+};
+
+struct EZALNavGrid {
+  struct EZALPrivateData* pd;
+  struct EZALNavGrid* next;
+
+  int width;
+  int height;
+  int cells;
+  bool diagonal;
+  unsigned char* cost;
+  unsigned int version;
+
+  // regions with a more expensive cell since the cache was last checked,
+  // a cheaper cell can shorten any path so it flushes the whole cache
+  int region_columns;
+  int region_words;
+  uint64_t* dirty;
+  bool dirty_any;
+  bool flush;
+
+  // connected areas of walkable cells, relabeled when a cell gets blocked
+  // or unblocked, queries from one area to another are answered without
+  // flooding the whole area first
+  int32_t* component;
+  bool components_dirty;
+
+  struct EZALNavCache cache;
+  struct EZALNavSearch searches[EZAL_NAV_MAX_WORKERS + 1];
+  struct EZALFlowField* fields;
+  struct EZALNavStats stats;
+};
+
+struct EZALNavWorker {
+  struct EZALNavPool* pool;
+  ALLEGRO_THREAD* thread;
+  int index;
+  unsigned int batch;
+};
+
+// the workers sleep until batch changes, then take pending queries off
+// next until none are left
+// everything below mutex is guarded by it, the batch itself is only
+// written while no worker is busy
+struct EZALNavPool {
+  struct EZALNavWorker workers[EZAL_NAV_MAX_WORKERS];
+  int worker_count;
+  bool started;
+
+  ALLEGRO_MUTEX* mutex;
+  ALLEGRO_COND* cond;
+  unsigned int batch;
+  int busy;
+  bool stopping;
+
+  struct EZALNavGrid* grid;
+  struct EZALNavQuery* queries;
+  int* pending;
+  int pending_count;
+  int pending_capacity;
+  atomic_int next;
+};
+
+struct EZALNavContext {
+  struct EZALNavPool pool;
+  struct EZALNavGrid* grids;
+};
+
+// an open archive, base is the whole file, mapped read only when the
+// platform has mmap and read into memory otherwise
+// samples play straight from the mapping, so the archive keeps track of
+// them and destroys them (which stops them) before it is unmapped
+struct EZALArchive {
+  struct EZALArchive* next;
+  unsigned char* base;
+  size_t size;
+  bool mapped;
+  const struct EZALPackEntry* entries;
+  int count;
+  ALLEGRO_SAMPLE** samples;
+  int sample_count;
+  int sample_capacity;
+};
+
 struct EZALPrivateData {
   struct EZALConfig cfg;
   struct EZALAllegroContext al_ctx;
@@ -42,680 +324,5188 @@ struct EZALPrivateData {
   void (*present)(struct EZALPrivateData*);
   void (*halt)(struct EZALPrivateData*);
   void (*resize)(struct EZALPrivateData*);
+
+  ALLEGRO_BITMAP* upload;
+  bool upload_failed;
+
+  bool in_background;
+  bool drawing_halted;
+  bool render_paused;
+  bool timer_paused;
+  int tick_rate;
+  double render_interval;
+  double last_render_time;
+
+  struct EZALCaptureContext capture;
+  struct EZALScheduler scheduler;
+  struct EZALBitmapRegistry bitmaps;
+  struct EZALNavContext nav;
+  struct EZALArchive* archives;
 };
 
-// ezal private function pointer targets
-void ezal_private_halt(struct EZALPrivateData* pd)
+// logging
+
+atomic_int ezal_log_active_level = EZAL_LOG_LEVEL_WARN;
+atomic_uint ezal_log_active_categories = EZAL_LOG_CATEGORY_ALL;
+
+static struct EZALLogContext ezal_private_log;
+
+void ezal_private_log_init_ring(void)
 {
-  pd->rt_ctx.is_running = false;
-  pd->rt_ctx.should_redraw = false;
+  for (size_t i = 0; i < EZAL_LOG_RING_SIZE; i++)
+  {
+    atomic_init(&ezal_private_log.ring[i].seq, i);
+  }
+  atomic_init(&ezal_private_log.write_pos, 0);
+  atomic_init(&ezal_private_log.read_pos, 0);
+  atomic_init(&ezal_private_log.dropped, 0);
+  atomic_init(&ezal_private_log.producers, 0);
+  atomic_init(&ezal_private_log.sleeping, false);
+  ezal_private_log.initialized = true;
 }
 
-void ezal_private_resize(struct EZALPrivateData* pd)
+void ezal_private_log_output(int level, const char* message)
 {
-  int display_width = al_get_display_width(pd->al_ctx.display);
-  int display_height = al_get_display_height(pd->al_ctx.display);
+  FILE* stream = level <= EZAL_LOG_LEVEL_WARN ? stderr : stdout;
+  // one call per line, so lines written synchronously from several
+  // threads don't interleave
+  fprintf(stream, "%s\n", message);
+}
 
-  pd->cfg.width = display_width;
-  pd->cfg.height = display_height;
+// pops one message off the ring and writes it, returns false when empty
+// only the writer thread (or the flushing thread once the writer is gone)
+// may call this
+bool ezal_private_log_drain_one(void)
+{
+  size_t pos = atomic_load_explicit(&ezal_private_log.read_pos, memory_order_relaxed);
+  struct EZALLogSlot* slot = &ezal_private_log.ring[pos & (EZAL_LOG_RING_SIZE - 1)];
+  size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
 
-  if (pd->cfg.stretch_scale)
+  if (seq != pos + 1)
   {
-    pd->x = 0;
-    pd->y = 0;
-    pd->w = display_width;
-    pd->h = display_height;
+    return false;
+  }
+
+  ezal_private_log_output(slot->level, slot->message);
+
+  atomic_store_explicit(&slot->seq, pos + EZAL_LOG_RING_SIZE, memory_order_release);
+  atomic_store_explicit(&ezal_private_log.read_pos, pos + 1, memory_order_release);
+
+  return true;
+}
+
+// true when the next slot to write has been published
+bool ezal_private_log_pending(void)
+{
+  size_t pos = atomic_load_explicit(&ezal_private_log.read_pos, memory_order_relaxed);
+  struct EZALLogSlot* slot = &ezal_private_log.ring[pos & (EZAL_LOG_RING_SIZE - 1)];
+  return atomic_load_explicit(&slot->seq, memory_order_acquire) == pos + 1;
+}
+
+// the writer sleeps on the cond while the ring is empty, producers only
+// take the mutex to wake it up when it is sleeping
+void* ezal_private_log_writer(ALLEGRO_THREAD* thread, void* arg)
+{
+  while (!al_get_thread_should_stop(thread))
+  {
+    bool wrote = false;
+    while (ezal_private_log_drain_one())
+    {
+      wrote = true;
+    }
+
+    if (wrote)
+    {
+      fflush(stdout);
+    }
+
+    al_lock_mutex(ezal_private_log.mutex);
+    atomic_store(&ezal_private_log.sleeping, true);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!al_get_thread_should_stop(thread) && !ezal_private_log_pending())
+    {
+      al_wait_cond(ezal_private_log.cond, ezal_private_log.mutex);
+    }
+    atomic_store(&ezal_private_log.sleeping, false);
+    al_unlock_mutex(ezal_private_log.mutex);
+  }
+
+  while (ezal_private_log_drain_one())
+  {
+  }
+  fflush(stdout);
+
+  return 0;
+}
+
+// stops the background writer after everything queued has been written
+void ezal_private_log_stop(void)
+{
+  if (!ezal_private_log.writer)
+  {
+    return;
+  }
+
+  // new messages are written synchronously from here on
+  atomic_store(&ezal_private_log.running, false);
+
+  al_set_thread_should_stop(ezal_private_log.writer);
+  al_lock_mutex(ezal_private_log.mutex);
+  al_signal_cond(ezal_private_log.cond);
+  al_unlock_mutex(ezal_private_log.mutex);
+  al_join_thread(ezal_private_log.writer, 0);
+  al_destroy_thread(ezal_private_log.writer);
+  ezal_private_log.writer = 0;
+
+  // catch anything that was queued while the writer was shutting down,
+  // including messages whose producer has claimed a slot but not yet
+  // published it
+  while (atomic_load(&ezal_private_log.producers) > 0 ||
+    atomic_load(&ezal_private_log.read_pos) != atomic_load(&ezal_private_log.write_pos))
+  {
+    if (!ezal_private_log_drain_one())
+    {
+      al_rest(0.0001);
+    }
+  }
+  fflush(stdout);
+
+  al_destroy_cond(ezal_private_log.cond);
+  al_destroy_mutex(ezal_private_log.mutex);
+  ezal_private_log.cond = 0;
+  ezal_private_log.mutex = 0;
+
+  unsigned int dropped = atomic_exchange(&ezal_private_log.dropped, 0);
+  if (dropped)
+  {
+    fprintf(stderr, "log ring buffer was full, %u messages were dropped.\n", dropped);
+  }
+}
+
+// starts the background writer, requires al_init
+// until it is running every message is written synchronously
+void ezal_private_log_start(void)
+{
+  if (ezal_private_log.writer)
+  {
+    return;
+  }
+
+  if (!ezal_private_log.initialized)
+  {
+    ezal_private_log_init_ring();
+    // make sure whatever is still queued gets written on exit(EXIT_FAILURE)
+    atexit(&ezal_private_log_stop);
+  }
+
+  ALLEGRO_MUTEX* mutex = al_create_mutex();
+  ALLEGRO_COND* cond = al_create_cond();
+  ALLEGRO_THREAD* writer = mutex && cond ? al_create_thread(&ezal_private_log_writer, 0) : 0;
+  if (!writer)
+  {
+    // messages keep being written synchronously
+    fprintf(stderr, "al_create_thread(log writer) failed.\n");
+    if (cond)
+    {
+      al_destroy_cond(cond);
+    }
+    if (mutex)
+    {
+      al_destroy_mutex(mutex);
+    }
+    return;
+  }
+
+  ezal_private_log.mutex = mutex;
+  ezal_private_log.cond = cond;
+  ezal_private_log.writer = writer;
+  atomic_store(&ezal_private_log.running, true);
+  al_start_thread(writer);
+}
+
+void ezal_private_log_configure(struct EZALConfig* cfg)
+{
+  ezal_log_set_level(cfg->log_level);
+  ezal_log_set_categories(cfg->log_categories);
+
+  if (cfg->debug && atomic_load(&ezal_log_active_level) < EZAL_LOG_LEVEL_DEBUG)
+  {
+    ezal_log_set_level(EZAL_LOG_LEVEL_DEBUG);
+  }
+}
+
+// frame capture
+
+struct EZALPrivateData* ezal_private_get_pd(struct EZALRuntimeContext* ctx)
+{
+  if (!ctx)
+  {
+    return 0;
+  }
+  return (struct EZALPrivateData*)ctx->_ezal_reserved;
+}
+
+bool ezal_private_capture_seek(FILE* fp, uint64_t offset)
+{
+#if defined(_WIN32)
+  return _fseeki64(fp, (__int64)offset, SEEK_SET) == 0;
+#else
+  return fseeko(fp, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+bool ezal_private_capture_write_frame(
+  struct EZALCaptureContext* cap,
+  struct EZALCaptureFrame* frame,
+  ALLEGRO_BITMAP* scratch)
+{
+  int width = cap->stats.width;
+  int height = cap->stats.height;
+  size_t row_size = (size_t)width * 4;
+
+  if (cap->cfg.format == EZAL_CAPTURE_FORMAT_RAW)
+  {
+    // frames land at their own offset so workers can finish out of order
+    bool ok;
+    al_lock_mutex(cap->file_mutex);
+    ok = ezal_private_capture_seek(cap->raw_file, (uint64_t)frame->index * cap->frame_size) &&
+      fwrite(frame->pixels, 1, cap->frame_size, cap->raw_file) == cap->frame_size;
+    al_unlock_mutex(cap->file_mutex);
+    return ok;
+  }
+
+  if (!scratch)
+  {
+    return false;
+  }
+
+  ALLEGRO_LOCKED_REGION* region = al_lock_bitmap(
+    scratch,
+    ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE,
+    ALLEGRO_LOCK_WRITEONLY);
+  if (!region)
+  {
+    return false;
+  }
+  for (int y = 0; y < height; y++)
+  {
+    memcpy(
+      (unsigned char*)region->data + y * region->pitch,
+      frame->pixels + y * row_size,
+      row_size);
+  }
+  al_unlock_bitmap(scratch);
+
+  char filename[EZAL_CAPTURE_MAX_PATH + 16];
+  snprintf(filename, sizeof(filename), "%s%06u.png", cap->path, frame->index);
+
+  return al_save_bitmap(filename, scratch);
+}
+
+void* ezal_private_capture_worker(ALLEGRO_THREAD* thread, void* arg)
+{
+  struct EZALCaptureContext* cap = (struct EZALCaptureContext*)arg;
+  ALLEGRO_BITMAP* scratch = 0;
+
+  if (cap->cfg.format == EZAL_CAPTURE_FORMAT_PNG)
+  {
+    // new bitmap flags are per thread, this never touches the display
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+    al_set_new_bitmap_format(ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE);
+    scratch = al_create_bitmap(cap->stats.width, cap->stats.height);
+    if (!scratch)
+    {
+      EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_CAPTURE, "al_create_bitmap(%d,%d) failed.", cap->stats.width, cap->stats.height);
+    }
+  }
+
+  for (;;)
+  {
+    al_lock_mutex(cap->mutex);
+    while (!cap->queue_head && !cap->stopping)
+    {
+      al_wait_cond(cap->cond, cap->mutex);
+    }
+    struct EZALCaptureFrame* frame = cap->queue_head;
+    if (!frame)
+    {
+      al_unlock_mutex(cap->mutex);
+      break;
+    }
+    cap->queue_head = frame->next;
+    if (!cap->queue_head)
+    {
+      cap->queue_tail = 0;
+    }
+    al_unlock_mutex(cap->mutex);
+
+    bool ok = ezal_private_capture_write_frame(cap, frame, scratch);
+
+    al_lock_mutex(cap->mutex);
+    if (ok)
+    {
+      cap->stats.frames_written++;
+    }
+    else
+    {
+      cap->stats.frames_failed++;
+    }
+    cap->stats.frames_pending--;
+    frame->next = cap->free_list;
+    cap->free_list = frame;
+    al_unlock_mutex(cap->mutex);
+
+    if (!ok)
+    {
+      EZAL_LOG(EZAL_LOG_LEVEL_WARN, EZAL_LOG_CATEGORY_CAPTURE, "failed to write capture frame %u", frame->index);
+    }
+  }
+
+  if (scratch)
+  {
+    al_destroy_bitmap(scratch);
+  }
+
+  return 0;
+}
+
+// copies the finished frame out of bitmap, called right before the flip
+// never waits on the workers, a frame with no free buffer is dropped
+void ezal_private_capture_frame(struct EZALPrivateData* pd, ALLEGRO_BITMAP* bitmap)
+{
+  struct EZALCaptureContext* cap = &pd->capture;
+
+  cap->stats.frames_presented++;
+  if ((cap->stats.frames_presented - 1) % cap->cfg.frame_interval != 0)
+  {
+    return;
+  }
+
+  al_lock_mutex(cap->mutex);
+  struct EZALCaptureFrame* frame = cap->free_list;
+  if (frame)
+  {
+    cap->free_list = frame->next;
   }
   else
   {
-    float ratio = (float)display_width / (float)pd->cfg.logical_width;
+    cap->stats.frames_dropped++;
+  }
+  al_unlock_mutex(cap->mutex);
 
-    if (display_height < ((float)pd->cfg.logical_height * ratio))
+  if (!frame)
+  {
+    return;
+  }
+
+  int width = al_get_bitmap_width(bitmap);
+  int height = al_get_bitmap_height(bitmap);
+  if (width > cap->stats.width) { width = cap->stats.width; }
+  if (height > cap->stats.height) { height = cap->stats.height; }
+  if (width != cap->stats.width || height != cap->stats.height)
+  {
+    memset(frame->pixels, 0, cap->frame_size);
+  }
+
+  ALLEGRO_LOCKED_REGION* region = al_lock_bitmap_region(
+    bitmap,
+    0,
+    0,
+    width,
+    height,
+    ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE,
+    ALLEGRO_LOCK_READONLY);
+
+  bool locked = region != 0;
+  if (locked)
+  {
+    size_t row_size = (size_t)width * 4;
+    size_t frame_row_size = (size_t)cap->stats.width * 4;
+    if (region->pitch == (int)frame_row_size && row_size == frame_row_size)
     {
-      ratio = (float)display_height / (float)pd->cfg.logical_height;
+      memcpy(frame->pixels, region->data, frame_row_size * height);
+    }
+    else
+    {
+      for (int y = 0; y < height; y++)
+      {
+        memcpy(
+          frame->pixels + y * frame_row_size,
+          (unsigned char*)region->data + y * region->pitch,
+          row_size);
+      }
     }
+    al_unlock_bitmap(bitmap);
+  }
 
-    pd->w = pd->cfg.logical_width * ratio;
-    pd->h = pd->cfg.logical_height * ratio;
-    pd->x = (display_width - pd->w) * 0.5f;
-    pd->y = (display_height - pd->h) * 0.5f;
+  al_lock_mutex(cap->mutex);
+  if (locked)
+  {
+    frame->index = cap->stats.frames_captured++;
+    frame->next = 0;
+    if (cap->queue_tail)
+    {
+      cap->queue_tail->next = frame;
+    }
+    else
+    {
+      cap->queue_head = frame;
+    }
+    cap->queue_tail = frame;
+    cap->stats.frames_pending++;
+    al_signal_cond(cap->cond);
+  }
+  else
+  {
+    cap->stats.frames_failed++;
+    frame->next = cap->free_list;
+    cap->free_list = frame;
+  }
+  al_unlock_mutex(cap->mutex);
+}
+
+void ezal_private_capture_release(struct EZALCaptureContext* cap)
+{
+  if (cap->frames)
+  {
+    for (int i = 0; i < cap->cfg.buffer_count; i++)
+    {
+      free(cap->frames[i].pixels);
+    }
+    free(cap->frames);
+    cap->frames = 0;
+  }
+
+  if (cap->raw_file)
+  {
+    fclose(cap->raw_file);
+    cap->raw_file = 0;
+  }
+
+  if (cap->cond)
+  {
+    al_destroy_cond(cap->cond);
+    cap->cond = 0;
+  }
+
+  if (cap->mutex)
+  {
+    al_destroy_mutex(cap->mutex);
+    cap->mutex = 0;
+  }
+
+  if (cap->file_mutex)
+  {
+    al_destroy_mutex(cap->file_mutex);
+    cap->file_mutex = 0;
+  }
+
+  cap->free_list = 0;
+  cap->queue_head = 0;
+  cap->queue_tail = 0;
+  cap->active = false;
+}
+
+bool ezal_private_capture_start(struct EZALPrivateData* pd, struct EZALCaptureConfig* cfg)
+{
+  struct EZALCaptureContext* cap = &pd->capture;
+
+  if (cap->active)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_WARN, EZAL_LOG_CATEGORY_CAPTURE, "capture is already running");
+    return false;
+  }
+
+  memset(cap, 0, sizeof(struct EZALCaptureContext));
+  ezal_use_capture_defaults(&cap->cfg);
+  if (cfg)
+  {
+    memcpy(&cap->cfg, cfg, sizeof(struct EZALCaptureConfig));
+  }
+  if (cap->cfg.buffer_count < 1) { cap->cfg.buffer_count = 1; }
+  if (cap->cfg.worker_count < 1) { cap->cfg.worker_count = 1; }
+  if (cap->cfg.worker_count > EZAL_CAPTURE_MAX_WORKERS) { cap->cfg.worker_count = EZAL_CAPTURE_MAX_WORKERS; }
+  if (cap->cfg.frame_interval < 1) { cap->cfg.frame_interval = 1; }
+
+  snprintf(cap->path, sizeof(cap->path), "%s", cap->cfg.path ? cap->cfg.path : "capture");
+  cap->cfg.path = cap->path;
+
+  ALLEGRO_BITMAP* source = pd->al_ctx.buffer
+    ? pd->al_ctx.buffer
+    : al_get_backbuffer(pd->al_ctx.display);
+  cap->stats.width = al_get_bitmap_width(source);
+  cap->stats.height = al_get_bitmap_height(source);
+  cap->frame_size = (size_t)cap->stats.width * (size_t)cap->stats.height * 4;
+
+  if (cap->cfg.format == EZAL_CAPTURE_FORMAT_RAW)
+  {
+    cap->raw_file = fopen(cap->path, "wb");
+    if (!cap->raw_file)
+    {
+      EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_CAPTURE, "fopen(%s) failed.", cap->path);
+      ezal_private_capture_release(cap);
+      return false;
+    }
+  }
+
+  cap->mutex = al_create_mutex();
+  cap->file_mutex = al_create_mutex();
+  cap->cond = al_create_cond();
+  cap->frames = (struct EZALCaptureFrame*)calloc(cap->cfg.buffer_count, sizeof(struct EZALCaptureFrame));
+  if (!cap->mutex || !cap->file_mutex || !cap->cond || !cap->frames)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_CAPTURE, "capture initialization failed.");
+    ezal_private_capture_release(cap);
+    return false;
+  }
+
+  for (int i = 0; i < cap->cfg.buffer_count; i++)
+  {
+    struct EZALCaptureFrame* frame = &cap->frames[i];
+    frame->pixels = (unsigned char*)malloc(cap->frame_size);
+    if (!frame->pixels)
+    {
+      EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_CAPTURE, "capture buffer allocation (%zu bytes) failed.", cap->frame_size);
+      ezal_private_capture_release(cap);
+      return false;
+    }
+    frame->next = cap->free_list;
+    cap->free_list = frame;
+  }
+
+  for (int i = 0; i < cap->cfg.worker_count; i++)
+  {
+    ALLEGRO_THREAD* worker = al_create_thread(&ezal_private_capture_worker, cap);
+    if (!worker)
+    {
+      EZAL_LOG(EZAL_LOG_LEVEL_WARN, EZAL_LOG_CATEGORY_CAPTURE, "al_create_thread(capture worker) failed.");
+      break;
+    }
+    cap->workers[cap->worker_count++] = worker;
+    al_start_thread(worker);
+  }
+
+  if (!cap->worker_count)
+  {
+    ezal_private_capture_release(cap);
+    return false;
+  }
+
+  cap->active = true;
+  EZAL_LOG(EZAL_LOG_LEVEL_INFO, EZAL_LOG_CATEGORY_CAPTURE, "capture started (%dx%d, %d buffers, %d workers) to %s",
+    cap->stats.width,
+    cap->stats.height,
+    cap->cfg.buffer_count,
+    cap->worker_count,
+    cap->path);
+
+  return true;
+}
+
+// stops accepting frames, waits for the workers to write what is queued
+void ezal_private_capture_stop(struct EZALPrivateData* pd)
+{
+  struct EZALCaptureContext* cap = &pd->capture;
+
+  if (!cap->active)
+  {
+    return;
+  }
+
+  al_lock_mutex(cap->mutex);
+  cap->stopping = true;
+  al_broadcast_cond(cap->cond);
+  al_unlock_mutex(cap->mutex);
+
+  for (int i = 0; i < cap->worker_count; i++)
+  {
+    al_join_thread(cap->workers[i], 0);
+    al_destroy_thread(cap->workers[i]);
+    cap->workers[i] = 0;
+  }
+  cap->worker_count = 0;
+
+  EZAL_LOG(EZAL_LOG_LEVEL_INFO, EZAL_LOG_CATEGORY_CAPTURE, "capture stopped: %u presented, %u captured, %u written, %u dropped, %u failed",
+    cap->stats.frames_presented,
+    cap->stats.frames_captured,
+    cap->stats.frames_written,
+    cap->stats.frames_dropped,
+    cap->stats.frames_failed);
+
+  ezal_private_capture_release(cap);
+}
+
+// scheduler
+
+void ezal_private_scheduler_init(struct EZALScheduler* sch)
+{
+  sch->nodes = 0;
+  sch->capacity = 0;
+  sch->free_head = -1;
+  sch->pending = 0;
+  sch->tick = 0;
+  for (int i = 0; i < EZAL_TIMER_LIST_COUNT; i++)
+  {
+    sch->heads[i] = -1;
+    sch->tails[i] = -1;
+  }
+}
+
+void ezal_private_scheduler_release(struct EZALScheduler* sch)
+{
+  if (sch->nodes)
+  {
+    free(sch->nodes);
+  }
+  ezal_private_scheduler_init(sch);
+}
+
+void ezal_private_timer_link(struct EZALScheduler* sch, int index, int list)
+{
+  struct EZALTimerNode* node = &sch->nodes[index];
+  node->list = list;
+  node->next = -1;
+  node->prev = sch->tails[list];
+  if (node->prev != -1)
+  {
+    sch->nodes[node->prev].next = index;
+  }
+  else
+  {
+    sch->heads[list] = index;
+  }
+  sch->tails[list] = index;
+}
+
+void ezal_private_timer_unlink(struct EZALScheduler* sch, int index)
+{
+  struct EZALTimerNode* node = &sch->nodes[index];
+  if (node->prev != -1)
+  {
+    sch->nodes[node->prev].next = node->next;
+  }
+  else
+  {
+    sch->heads[node->list] = node->next;
+  }
+  if (node->next != -1)
+  {
+    sch->nodes[node->next].prev = node->prev;
+  }
+  else
+  {
+    sch->tails[node->list] = node->prev;
+  }
+  node->list = -1;
+}
+
+// picks the wheel slot for a timer relative to the current tick
+int ezal_private_timer_wheel_list(uint64_t tick, uint64_t expires)
+{
+  uint64_t distance = expires - tick;
+  int level = 0;
+  while (level < EZAL_TIMER_WHEEL_LEVELS - 1 &&
+    distance >= ((uint64_t)1 << (EZAL_TIMER_WHEEL_BITS * (level + 1))))
+  {
+    level++;
+  }
+  int slot = (int)((expires >> (EZAL_TIMER_WHEEL_BITS * level)) & EZAL_TIMER_WHEEL_MASK);
+  return level * EZAL_TIMER_WHEEL_SLOTS + slot;
+}
+
+int ezal_private_timer_alloc(struct EZALScheduler* sch)
+{
+  if (sch->free_head == -1)
+  {
+    if (sch->capacity >= EZAL_TIMER_MAX_TIMERS)
+    {
+      EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_SCHEDULER, "timer pool is full (%d timers)", sch->capacity);
+      return -1;
+    }
+
+    int capacity = sch->capacity ? sch->capacity * 2 : 64;
+    if (capacity > EZAL_TIMER_MAX_TIMERS)
+    {
+      capacity = EZAL_TIMER_MAX_TIMERS;
+    }
+
+    struct EZALTimerNode* nodes = (struct EZALTimerNode*)realloc(
+      sch->nodes,
+      capacity * sizeof(struct EZALTimerNode));
+    if (!nodes)
+    {
+      EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_SCHEDULER, "timer pool allocation (%d timers) failed.", capacity);
+      return -1;
+    }
+
+    for (int i = capacity - 1; i >= sch->capacity; i--)
+    {
+      nodes[i].generation = 0;
+      nodes[i].list = -1;
+      nodes[i].next = sch->free_head;
+      sch->free_head = i;
+    }
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_SCHEDULER, "timer pool grown to %d timers", capacity);
+
+    sch->nodes = nodes;
+    sch->capacity = capacity;
+  }
+
+  int index = sch->free_head;
+  sch->free_head = sch->nodes[index].next;
+  sch->pending++;
+
+  return index;
+}
+
+void ezal_private_timer_free(struct EZALScheduler* sch, int index)
+{
+  struct EZALTimerNode* node = &sch->nodes[index];
+  node->generation = (node->generation + 1) & (0xFFFFFFFFu >> EZAL_TIMER_INDEX_BITS);
+  node->list = -1;
+  node->next = sch->free_head;
+  sch->free_head = index;
+  sch->pending--;
+}
+
+unsigned int ezal_private_timer_id(struct EZALScheduler* sch, int index)
+{
+  return (sch->nodes[index].generation << EZAL_TIMER_INDEX_BITS) | (unsigned int)(index + 1);
+}
+
+// returns the index of a pending timer or -1 when the id is stale
+int ezal_private_timer_lookup(struct EZALScheduler* sch, unsigned int timer)
+{
+  int index = (int)(timer & EZAL_TIMER_INDEX_MASK) - 1;
+  if (index < 0 || index >= sch->capacity)
+  {
+    return -1;
+  }
+  if (sch->nodes[index].list == -1 || ezal_private_timer_id(sch, index) != timer)
+  {
+    return -1;
+  }
+  return index;
+}
+
+unsigned int ezal_private_timer_schedule(
+  struct EZALScheduler* sch,
+  unsigned int delay,
+  unsigned int interval,
+  EZALTIMERFPTR fn,
+  void* data)
+{
+  if (!fn)
+  {
+    return 0;
+  }
+
+  int index = ezal_private_timer_alloc(sch);
+  if (index == -1)
+  {
+    return 0;
+  }
+
+  struct EZALTimerNode* node = &sch->nodes[index];
+  node->fn = fn;
+  node->data = data;
+  node->interval = interval;
+  node->expires = sch->tick + (delay ? delay : 1);
+  ezal_private_timer_link(sch, index, ezal_private_timer_wheel_list(sch->tick, node->expires));
+
+  return ezal_private_timer_id(sch, index);
+}
+
+// moves every timer in the current slot of a level down the wheel,
+// returns the slot so the caller knows if the next level wrapped too
+int ezal_private_scheduler_cascade(struct EZALScheduler* sch, int level)
+{
+  int slot = (int)((sch->tick >> (EZAL_TIMER_WHEEL_BITS * level)) & EZAL_TIMER_WHEEL_MASK);
+  int list = level * EZAL_TIMER_WHEEL_SLOTS + slot;
+  int index = sch->heads[list];
+
+  sch->heads[list] = -1;
+  sch->tails[list] = -1;
+  while (index != -1)
+  {
+    int next = sch->nodes[index].next;
+    ezal_private_timer_link(
+      sch,
+      index,
+      ezal_private_timer_wheel_list(sch->tick, sch->nodes[index].expires));
+    index = next;
+  }
+
+  return slot;
+}
+
+// advances the wheel by one tick and fires every timer that is due
+// callbacks may schedule and cancel timers, including the ones still
+// waiting in this batch
+void ezal_private_scheduler_advance(struct EZALPrivateData* pd)
+{
+  struct EZALScheduler* sch = &pd->scheduler;
+
+  sch->tick++;
+
+  int slot = (int)(sch->tick & EZAL_TIMER_WHEEL_MASK);
+  if (slot == 0)
+  {
+    for (int level = 1; level < EZAL_TIMER_WHEEL_LEVELS; level++)
+    {
+      if (ezal_private_scheduler_cascade(sch, level) != 0)
+      {
+        break;
+      }
+    }
+  }
+
+  if (sch->heads[slot] == -1)
+  {
+    return;
+  }
+
+  sch->heads[EZAL_TIMER_FIRING_LIST] = sch->heads[slot];
+  sch->tails[EZAL_TIMER_FIRING_LIST] = sch->tails[slot];
+  sch->heads[slot] = -1;
+  sch->tails[slot] = -1;
+  for (int index = sch->heads[EZAL_TIMER_FIRING_LIST]; index != -1; index = sch->nodes[index].next)
+  {
+    sch->nodes[index].list = EZAL_TIMER_FIRING_LIST;
+  }
+
+  int index;
+  while ((index = sch->heads[EZAL_TIMER_FIRING_LIST]) != -1)
+  {
+    ezal_private_timer_unlink(sch, index);
+
+    struct EZALTimerNode* node = &sch->nodes[index];
+    EZALTIMERFPTR fn = node->fn;
+    void* data = node->data;
+
+    if (node->interval)
+    {
+      node->expires = sch->tick + node->interval;
+      ezal_private_timer_link(sch, index, ezal_private_timer_wheel_list(sch->tick, node->expires));
+    }
+    else
+    {
+      ezal_private_timer_free(sch, index);
+    }
+
+    fn(&pd->rt_ctx, data);
+  }
+}
+
+// bitmap registry
+
+bool ezal_private_bitmaps_init(struct EZALBitmapRegistry* reg)
+{
+  memset(reg, 0, sizeof(struct EZALBitmapRegistry));
+  reg->last_warning_time = -1.0;
+  reg->mutex = al_create_mutex();
+  if (!reg->mutex)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_BITMAP, "al_create_mutex failed.");
+    return false;
+  }
+  return true;
+}
+
+// forgets every bitmap that is still registered, it does not destroy
+// them, the game may already have done that with al_destroy_bitmap and
+// allegro destroys whatever is left when it shuts down
+void ezal_private_bitmaps_release(struct EZALBitmapRegistry* reg)
+{
+  if (reg->entries)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_BITMAP, "released %d registered bitmaps", reg->count);
+    free(reg->entries);
+  }
+
+  if (reg->mutex)
+  {
+    al_destroy_mutex(reg->mutex);
+  }
+
+  memset(reg, 0, sizeof(struct EZALBitmapRegistry));
+}
+
+size_t ezal_private_bitmap_bytes(ALLEGRO_BITMAP* bitmap)
+{
+  if (al_get_parent_bitmap(bitmap))
+  {
+    // sub bitmaps share the memory of their parent
+    return 0;
+  }
+  return (size_t)al_get_bitmap_width(bitmap) *
+    (size_t)al_get_bitmap_height(bitmap) *
+    (size_t)al_get_pixel_size(al_get_bitmap_format(bitmap));
+}
+
+bool ezal_private_bitmap_is_memory(ALLEGRO_BITMAP* bitmap)
+{
+  return (al_get_bitmap_flags(bitmap) & ALLEGRO_MEMORY_BITMAP) != 0;
+}
+
+bool ezal_private_bitmaps_add(struct EZALBitmapRegistry* reg, ALLEGRO_BITMAP* bitmap)
+{
+  al_lock_mutex(reg->mutex);
+
+  if (reg->count == reg->capacity)
+  {
+    int capacity = reg->capacity ? reg->capacity * 2 : 64;
+    struct EZALBitmapEntry* entries = (struct EZALBitmapEntry*)realloc(
+      reg->entries,
+      capacity * sizeof(struct EZALBitmapEntry));
+    if (!entries)
+    {
+      al_unlock_mutex(reg->mutex);
+      EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_BITMAP, "bitmap registry allocation (%d bitmaps) failed.", capacity);
+      return false;
+    }
+    reg->entries = entries;
+    reg->capacity = capacity;
+  }
+
+  struct EZALBitmapEntry* entry = &reg->entries[reg->count++];
+  entry->bitmap = bitmap;
+  entry->bytes = ezal_private_bitmap_bytes(bitmap);
+  entry->keep_memory = ezal_private_bitmap_is_memory(bitmap) &&
+    !(al_get_bitmap_flags(bitmap) & ALLEGRO_CONVERT_BITMAP);
+
+  al_unlock_mutex(reg->mutex);
+
+  return true;
+}
+
+bool ezal_private_bitmaps_remove(struct EZALBitmapRegistry* reg, ALLEGRO_BITMAP* bitmap)
+{
+  bool found = false;
+
+  al_lock_mutex(reg->mutex);
+  for (int i = 0; i < reg->count; i++)
+  {
+    if (reg->entries[i].bitmap == bitmap)
+    {
+      reg->entries[i] = reg->entries[--reg->count];
+      found = true;
+      break;
+    }
+  }
+  al_unlock_mutex(reg->mutex);
+
+  return found;
+}
+
+void ezal_private_bitmaps_stats(struct EZALBitmapRegistry* reg, struct EZALBitmapStats* stats)
+{
+  memset(stats, 0, sizeof(struct EZALBitmapStats));
+
+  al_lock_mutex(reg->mutex);
+  for (int i = 0; i < reg->count; i++)
+  {
+    struct EZALBitmapEntry* entry = &reg->entries[i];
+    if (ezal_private_bitmap_is_memory(entry->bitmap))
+    {
+      stats->memory_count++;
+      stats->memory_bytes += entry->bytes;
+    }
+    else
+    {
+      stats->video_count++;
+      stats->video_bytes += entry->bytes;
+    }
+  }
+  stats->bitmap_count = reg->count;
+  stats->promoted = reg->promoted;
+  stats->memory_draws = reg->memory_draws;
+  stats->memory_draw_frames = reg->memory_draw_frames;
+  al_unlock_mutex(reg->mutex);
+}
+
+// converts registered memory bitmaps to video bitmaps of the display,
+// except the ones that were created as memory bitmaps on purpose
+// must run on the thread that owns the display
+int ezal_private_promote_bitmaps(struct EZALPrivateData* pd, const char* reason)
+{
+  struct EZALBitmapRegistry* reg = &pd->bitmaps;
+
+  if (!pd->al_ctx.display || !reg->mutex)
+  {
+    return 0;
+  }
+
+  int promoted = 0;
+  int remaining = 0;
+  int new_flags = al_get_new_bitmap_flags();
+  al_set_new_bitmap_flags((new_flags & ~ALLEGRO_MEMORY_BITMAP) | ALLEGRO_VIDEO_BITMAP);
+
+  al_lock_mutex(reg->mutex);
+  for (int i = 0; i < reg->count; i++)
+  {
+    ALLEGRO_BITMAP* bitmap = reg->entries[i].bitmap;
+    if (reg->entries[i].keep_memory ||
+      !ezal_private_bitmap_is_memory(bitmap) ||
+      al_get_parent_bitmap(bitmap) ||
+      al_is_bitmap_locked(bitmap))
+    {
+      continue;
+    }
+
+    al_convert_bitmap(bitmap);
+    if (ezal_private_bitmap_is_memory(bitmap))
+    {
+      remaining++;
+    }
+    else
+    {
+      promoted++;
+    }
+  }
+  reg->promoted += promoted;
+  al_unlock_mutex(reg->mutex);
+
+  al_set_new_bitmap_flags(new_flags);
+
+  if (promoted || remaining)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_BITMAP, "%s: promoted %d memory bitmaps to video, %d could not be promoted",
+      reason,
+      promoted,
+      remaining);
+  }
+
+  return promoted;
+}
+
+// counts draws of memory bitmaps onto video targets, those go through
+// the slow software path
+void ezal_private_note_bitmap_draw(struct EZALPrivateData* pd, ALLEGRO_BITMAP* bitmap)
+{
+  if (pd && bitmap && ezal_private_bitmap_is_memory(bitmap))
+  {
+    ALLEGRO_BITMAP* target = al_get_target_bitmap();
+    if (target && !ezal_private_bitmap_is_memory(target))
+    {
+      pd->bitmaps.frame_memory_draws++;
+    }
+  }
+}
+
+void ezal_private_bitmaps_end_frame(struct EZALPrivateData* pd)
+{
+  struct EZALBitmapRegistry* reg = &pd->bitmaps;
+
+  if (!reg->frame_memory_draws)
+  {
+    return;
+  }
+
+  unsigned int draws = reg->frame_memory_draws;
+  reg->frame_memory_draws = 0;
+
+  al_lock_mutex(reg->mutex);
+  reg->memory_draws += draws;
+  reg->memory_draw_frames++;
+  al_unlock_mutex(reg->mutex);
+
+  // at most one warning per second
+  double now = al_get_time();
+  if (now - reg->last_warning_time < 1.0 ||
+    !EZAL_LOG_ENABLED(EZAL_LOG_LEVEL_WARN, EZAL_LOG_CATEGORY_BITMAP))
+  {
+    return;
+  }
+  reg->last_warning_time = now;
+
+  struct EZALBitmapStats stats;
+  ezal_private_bitmaps_stats(reg, &stats);
+  ezal_log_write(EZAL_LOG_LEVEL_WARN, EZAL_LOG_CATEGORY_BITMAP,
+    "frame drew %u memory bitmaps (slow path), %u frames so far; registry: %d video (%zu KiB), %d memory (%zu KiB)",
+    draws,
+    stats.memory_draw_frames,
+    stats.video_count,
+    stats.video_bytes / 1024,
+    stats.memory_count,
+    stats.memory_bytes / 1024);
+}
+
+// software blitter
+// fast paths for drawing onto memory bitmaps, Allegro's generic software
+// renderer handles one pixel at a time through float colors
+// all kernels work on 32 bit premultiplied pixels with alpha in the top
+// byte, the channel order of the other bytes does not matter to them
+
+#define EZAL_BLIT_MODE_NONE 0
+#define EZAL_BLIT_MODE_COPY 1
+#define EZAL_BLIT_MODE_BLEND 2
+
+// rows up to this many pixels are staged on the stack
+#define EZAL_BLIT_STACK_ROW 1024
+
+struct EZALBlitKernels {
+  const char* name;
+  void (*fill)(uint32_t* dst, int count, uint32_t color);
+  void (*blend_fill)(uint32_t* dst, int count, uint32_t color);
+  void (*copy)(uint32_t* dst, const uint32_t* src, int count);
+  void (*blend)(uint32_t* dst, const uint32_t* src, int count);
+  void (*tint_blend)(uint32_t* dst, const uint32_t* src, int count, uint32_t tint);
+  void (*gather)(uint32_t* dst, const uint32_t* src, const int* index, int count);
+};
+
+static struct EZALBlitKernels ezal_private_blit;
+
+// multiplies all four channels by f / 255 with rounding
+static inline uint32_t ezal_private_px_scale(uint32_t px, uint32_t f)
+{
+  uint32_t rb = (px & 0x00FF00FFu) * f + 0x00800080u;
+  rb = ((rb + ((rb >> 8) & 0x00FF00FFu)) >> 8) & 0x00FF00FFu;
+  uint32_t ag = ((px >> 8) & 0x00FF00FFu) * f + 0x00800080u;
+  ag = (ag + ((ag >> 8) & 0x00FF00FFu)) & 0xFF00FF00u;
+  return rb | ag;
+}
+
+// per channel saturating add
+static inline uint32_t ezal_private_px_adds(uint32_t a, uint32_t b)
+{
+  uint32_t sum = ((a & 0x7F7F7F7Fu) + (b & 0x7F7F7F7Fu)) ^ ((a ^ b) & 0x80808080u);
+  uint32_t carry = ((a & b) | ((a | b) & ~sum)) & 0x80808080u;
+  return sum | ((carry >> 7) * 0xFFu);
+}
+
+// premultiplied source over destination (ONE, INVERSE_ALPHA)
+static inline uint32_t ezal_private_px_over(uint32_t s, uint32_t d)
+{
+  uint32_t alpha = s >> 24;
+  if (alpha == 0xFF)
+  {
+    return s;
+  }
+  return ezal_private_px_adds(s, ezal_private_px_scale(d, 0xFF - alpha));
+}
+
+static inline uint32_t ezal_private_px_tint(uint32_t s, uint32_t t)
+{
+  uint32_t result = 0;
+  for (int shift = 0; shift < 32; shift += 8)
+  {
+    uint32_t x = ((s >> shift) & 0xFF) * ((t >> shift) & 0xFF) + 128;
+    result |= (((x + (x >> 8)) >> 8) & 0xFF) << shift;
+  }
+  return result;
+}
+
+void ezal_private_blit_fill_scalar(uint32_t* dst, int count, uint32_t color)
+{
+  for (int i = 0; i < count; i++)
+  {
+    dst[i] = color;
+  }
+}
+
+void ezal_private_blit_blend_fill_scalar(uint32_t* dst, int count, uint32_t color)
+{
+  uint32_t inverse_alpha = 0xFF - (color >> 24);
+  for (int i = 0; i < count; i++)
+  {
+    dst[i] = ezal_private_px_adds(color, ezal_private_px_scale(dst[i], inverse_alpha));
+  }
+}
+
+void ezal_private_blit_copy_scalar(uint32_t* dst, const uint32_t* src, int count)
+{
+  memcpy(dst, src, (size_t)count * sizeof(uint32_t));
+}
+
+void ezal_private_blit_blend_scalar(uint32_t* dst, const uint32_t* src, int count)
+{
+  for (int i = 0; i < count; i++)
+  {
+    uint32_t s = src[i];
+    if (s)
+    {
+      dst[i] = ezal_private_px_over(s, dst[i]);
+    }
+  }
+}
+
+void ezal_private_blit_tint_blend_scalar(uint32_t* dst, const uint32_t* src, int count, uint32_t tint)
+{
+  for (int i = 0; i < count; i++)
+  {
+    uint32_t s = ezal_private_px_tint(src[i], tint);
+    if (s)
+    {
+      dst[i] = ezal_private_px_over(s, dst[i]);
+    }
+  }
+}
+
+void ezal_private_blit_gather_scalar(uint32_t* dst, const uint32_t* src, const int* index, int count)
+{
+  for (int i = 0; i < count; i++)
+  {
+    dst[i] = src[index[i]];
+  }
+}
+
+#if defined(EZAL_BLIT_SSE2)
+// 16 bit lanes: (v * f + 128 + ((v * f + 128) >> 8)) >> 8 == round(v * f / 255)
+static inline __m128i ezal_private_sse2_scale(__m128i v, __m128i f)
+{
+  __m128i x = _mm_add_epi16(_mm_mullo_epi16(v, f), _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+static inline __m128i ezal_private_sse2_over(__m128i s, __m128i d)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128i max = _mm_set1_epi16(0xFF);
+  __m128i s_lo = _mm_unpacklo_epi8(s, zero);
+  __m128i s_hi = _mm_unpackhi_epi8(s, zero);
+  __m128i ia_lo = _mm_sub_epi16(max, _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_lo, 0xFF), 0xFF));
+  __m128i ia_hi = _mm_sub_epi16(max, _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_hi, 0xFF), 0xFF));
+  __m128i d_lo = ezal_private_sse2_scale(_mm_unpacklo_epi8(d, zero), ia_lo);
+  __m128i d_hi = ezal_private_sse2_scale(_mm_unpackhi_epi8(d, zero), ia_hi);
+  return _mm_adds_epu8(s, _mm_packus_epi16(d_lo, d_hi));
+}
+
+static inline __m128i ezal_private_sse2_tint(__m128i s, __m128i t16)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128i lo = ezal_private_sse2_scale(_mm_unpacklo_epi8(s, zero), t16);
+  __m128i hi = ezal_private_sse2_scale(_mm_unpackhi_epi8(s, zero), t16);
+  return _mm_packus_epi16(lo, hi);
+}
+
+// blends 4 pixels, skipping the math when they are all opaque or all clear
+static inline void ezal_private_sse2_over_store(uint32_t* dst, __m128i s)
+{
+  __m128i alpha_mask = _mm_set1_epi32((int)0xFF000000u);
+  __m128i alpha = _mm_and_si128(s, alpha_mask);
+  if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alpha_mask)) == 0xFFFF)
+  {
+    _mm_storeu_si128((__m128i*)dst, s);
+  }
+  else if (_mm_movemask_epi8(_mm_cmpeq_epi32(s, _mm_setzero_si128())) != 0xFFFF)
+  {
+    __m128i d = _mm_loadu_si128((const __m128i*)dst);
+    _mm_storeu_si128((__m128i*)dst, ezal_private_sse2_over(s, d));
+  }
+}
+
+void ezal_private_blit_fill_sse2(uint32_t* dst, int count, uint32_t color)
+{
+  __m128i c = _mm_set1_epi32((int)color);
+  int i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    _mm_storeu_si128((__m128i*)(dst + i), c);
+  }
+  ezal_private_blit_fill_scalar(dst + i, count - i, color);
+}
+
+void ezal_private_blit_blend_fill_sse2(uint32_t* dst, int count, uint32_t color)
+{
+  __m128i c = _mm_set1_epi32((int)color);
+  int i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+    _mm_storeu_si128((__m128i*)(dst + i), ezal_private_sse2_over(c, d));
+  }
+  ezal_private_blit_blend_fill_scalar(dst + i, count - i, color);
+}
+
+void ezal_private_blit_blend_sse2(uint32_t* dst, const uint32_t* src, int count)
+{
+  int i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    ezal_private_sse2_over_store(dst + i, _mm_loadu_si128((const __m128i*)(src + i)));
+  }
+  ezal_private_blit_blend_scalar(dst + i, src + i, count - i);
+}
+
+void ezal_private_blit_tint_blend_sse2(uint32_t* dst, const uint32_t* src, int count, uint32_t tint)
+{
+  __m128i t16 = _mm_unpacklo_epi8(_mm_set1_epi32((int)tint), _mm_setzero_si128());
+  int i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128i s = ezal_private_sse2_tint(_mm_loadu_si128((const __m128i*)(src + i)), t16);
+    ezal_private_sse2_over_store(dst + i, s);
+  }
+  ezal_private_blit_tint_blend_scalar(dst + i, src + i, count - i, tint);
+}
+#endif
+
+#if defined(EZAL_BLIT_AVX2)
+__attribute__((target("avx2")))
+static inline __m256i ezal_private_avx2_scale(__m256i v, __m256i f)
+{
+  __m256i x = _mm256_add_epi16(_mm256_mullo_epi16(v, f), _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i ezal_private_avx2_over(__m256i s, __m256i d)
+{
+  __m256i zero = _mm256_setzero_si256();
+  __m256i max = _mm256_set1_epi16(0xFF);
+  __m256i s_lo = _mm256_unpacklo_epi8(s, zero);
+  __m256i s_hi = _mm256_unpackhi_epi8(s, zero);
+  __m256i ia_lo = _mm256_sub_epi16(max, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s_lo, 0xFF), 0xFF));
+  __m256i ia_hi = _mm256_sub_epi16(max, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s_hi, 0xFF), 0xFF));
+  __m256i d_lo = ezal_private_avx2_scale(_mm256_unpacklo_epi8(d, zero), ia_lo);
+  __m256i d_hi = ezal_private_avx2_scale(_mm256_unpackhi_epi8(d, zero), ia_hi);
+  return _mm256_adds_epu8(s, _mm256_packus_epi16(d_lo, d_hi));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i ezal_private_avx2_tint(__m256i s, __m256i t16)
+{
+  __m256i zero = _mm256_setzero_si256();
+  __m256i lo = ezal_private_avx2_scale(_mm256_unpacklo_epi8(s, zero), t16);
+  __m256i hi = ezal_private_avx2_scale(_mm256_unpackhi_epi8(s, zero), t16);
+  return _mm256_packus_epi16(lo, hi);
+}
+
+__attribute__((target("avx2")))
+static inline void ezal_private_avx2_over_store(uint32_t* dst, __m256i s)
+{
+  __m256i alpha_mask = _mm256_set1_epi32((int)0xFF000000u);
+  __m256i alpha = _mm256_and_si256(s, alpha_mask);
+  if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(alpha, alpha_mask)) == -1)
+  {
+    _mm256_storeu_si256((__m256i*)dst, s);
+  }
+  else if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(s, _mm256_setzero_si256())) != -1)
+  {
+    __m256i d = _mm256_loadu_si256((const __m256i*)dst);
+    _mm256_storeu_si256((__m256i*)dst, ezal_private_avx2_over(s, d));
+  }
+}
+
+__attribute__((target("avx2")))
+void ezal_private_blit_fill_avx2(uint32_t* dst, int count, uint32_t color)
+{
+  __m256i c = _mm256_set1_epi32((int)color);
+  int i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    _mm256_storeu_si256((__m256i*)(dst + i), c);
+  }
+  ezal_private_blit_fill_scalar(dst + i, count - i, color);
+}
+
+__attribute__((target("avx2")))
+void ezal_private_blit_blend_fill_avx2(uint32_t* dst, int count, uint32_t color)
+{
+  __m256i c = _mm256_set1_epi32((int)color);
+  int i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+    _mm256_storeu_si256((__m256i*)(dst + i), ezal_private_avx2_over(c, d));
+  }
+  ezal_private_blit_blend_fill_scalar(dst + i, count - i, color);
+}
+
+__attribute__((target("avx2")))
+void ezal_private_blit_blend_avx2(uint32_t* dst, const uint32_t* src, int count)
+{
+  int i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    ezal_private_avx2_over_store(dst + i, _mm256_loadu_si256((const __m256i*)(src + i)));
+  }
+  ezal_private_blit_blend_scalar(dst + i, src + i, count - i);
+}
+
+__attribute__((target("avx2")))
+void ezal_private_blit_tint_blend_avx2(uint32_t* dst, const uint32_t* src, int count, uint32_t tint)
+{
+  __m256i t16 = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)tint), _mm256_setzero_si256());
+  int i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    __m256i s = ezal_private_avx2_tint(_mm256_loadu_si256((const __m256i*)(src + i)), t16);
+    ezal_private_avx2_over_store(dst + i, s);
+  }
+  ezal_private_blit_tint_blend_scalar(dst + i, src + i, count - i, tint);
+}
+
+__attribute__((target("avx2")))
+void ezal_private_blit_gather_avx2(uint32_t* dst, const uint32_t* src, const int* index, int count)
+{
+  int i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    __m256i idx = _mm256_loadu_si256((const __m256i*)(index + i));
+    _mm256_storeu_si256((__m256i*)(dst + i), _mm256_i32gather_epi32((const int*)src, idx, 4));
+  }
+  ezal_private_blit_gather_scalar(dst + i, src, index + i, count - i);
+}
+#endif
+
+// picks the widest kernels the cpu supports
+void ezal_private_blit_init(void)
+{
+  ezal_private_blit.name = "scalar";
+  ezal_private_blit.fill = &ezal_private_blit_fill_scalar;
+  ezal_private_blit.blend_fill = &ezal_private_blit_blend_fill_scalar;
+  ezal_private_blit.copy = &ezal_private_blit_copy_scalar;
+  ezal_private_blit.blend = &ezal_private_blit_blend_scalar;
+  ezal_private_blit.tint_blend = &ezal_private_blit_tint_blend_scalar;
+  ezal_private_blit.gather = &ezal_private_blit_gather_scalar;
+
+#if defined(EZAL_BLIT_SSE2)
+  ezal_private_blit.name = "sse2";
+  ezal_private_blit.fill = &ezal_private_blit_fill_sse2;
+  ezal_private_blit.blend_fill = &ezal_private_blit_blend_fill_sse2;
+  ezal_private_blit.blend = &ezal_private_blit_blend_sse2;
+  ezal_private_blit.tint_blend = &ezal_private_blit_tint_blend_sse2;
+#endif
+
+#if defined(EZAL_BLIT_AVX2)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+  {
+    ezal_private_blit.name = "avx2";
+    ezal_private_blit.fill = &ezal_private_blit_fill_avx2;
+    ezal_private_blit.blend_fill = &ezal_private_blit_blend_fill_avx2;
+    ezal_private_blit.blend = &ezal_private_blit_blend_avx2;
+    ezal_private_blit.tint_blend = &ezal_private_blit_tint_blend_avx2;
+    ezal_private_blit.gather = &ezal_private_blit_gather_avx2;
+  }
+#endif
+
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_RENDER, "software blitter using %s kernels", ezal_private_blit.name);
+}
+
+// formats whose pixels are one 32 bit word with alpha in the top byte
+bool ezal_private_blit_format_ok(int format)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  return format == ALLEGRO_PIXEL_FORMAT_ARGB_8888 ||
+    format == ALLEGRO_PIXEL_FORMAT_ABGR_8888 ||
+    format == ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE;
+#else
+  return false;
+#endif
+}
+
+uint32_t ezal_private_blit_color(ALLEGRO_COLOR color, int format)
+{
+  unsigned char r, g, b, a;
+  al_unmap_rgba(color, &r, &g, &b, &a);
+  if (format == ALLEGRO_PIXEL_FORMAT_ARGB_8888)
+  {
+    return ((uint32_t)a << 24) | ((uint32_t)r << 16) | ((uint32_t)g << 8) | (uint32_t)b;
+  }
+  return ((uint32_t)a << 24) | ((uint32_t)b << 16) | ((uint32_t)g << 8) | (uint32_t)r;
+}
+
+// the target must be an unlocked memory bitmap the kernels understand
+ALLEGRO_BITMAP* ezal_private_blit_target(void)
+{
+  ALLEGRO_BITMAP* target = al_get_target_bitmap();
+  if (!target ||
+    !(al_get_bitmap_flags(target) & ALLEGRO_MEMORY_BITMAP) ||
+    al_is_bitmap_locked(target) ||
+    al_is_bitmap_drawing_held() ||
+    !ezal_private_blit_format_ok(al_get_bitmap_format(target)))
+  {
+    return 0;
+  }
+  return target;
+}
+
+// drawing (unlike clearing) honors the transform and the blender
+int ezal_private_blit_mode(void)
+{
+  ALLEGRO_TRANSFORM identity;
+  al_identity_transform(&identity);
+  if (memcmp(al_get_current_transform(), &identity, sizeof(ALLEGRO_TRANSFORM)) != 0)
+  {
+    return EZAL_BLIT_MODE_NONE;
+  }
+
+  int op, src, dst, alpha_op, alpha_src, alpha_dst;
+  al_get_separate_blender(&op, &src, &dst, &alpha_op, &alpha_src, &alpha_dst);
+  if (op != ALLEGRO_ADD || alpha_op != ALLEGRO_ADD ||
+    src != ALLEGRO_ONE || alpha_src != ALLEGRO_ONE ||
+    dst != alpha_dst)
+  {
+    return EZAL_BLIT_MODE_NONE;
+  }
+  if (dst == ALLEGRO_INVERSE_ALPHA)
+  {
+    return EZAL_BLIT_MODE_BLEND;
+  }
+  if (dst == ALLEGRO_ZERO)
+  {
+    return EZAL_BLIT_MODE_COPY;
+  }
+  return EZAL_BLIT_MODE_NONE;
+}
+
+// intersects x, y, w, h with the clipping rectangle of the target
+bool ezal_private_blit_clip(int* x, int* y, int* w, int* h)
+{
+  int cx, cy, cw, ch;
+  al_get_clipping_rectangle(&cx, &cy, &cw, &ch);
+
+  int x1 = *x > cx ? *x : cx;
+  int y1 = *y > cy ? *y : cy;
+  int x2 = *x + *w < cx + cw ? *x + *w : cx + cw;
+  int y2 = *y + *h < cy + ch ? *y + *h : cy + ch;
+  if (x2 <= x1 || y2 <= y1)
+  {
+    return false;
+  }
+
+  *x = x1;
+  *y = y1;
+  *w = x2 - x1;
+  *h = y2 - y1;
+  return true;
+}
+
+bool ezal_private_is_integer(float value)
+{
+  return value == (float)(int)value;
+}
+
+// fills x, y, w, h of the target with color, blending when asked to
+bool ezal_private_soft_fill(ALLEGRO_BITMAP* target, int x, int y, int w, int h, ALLEGRO_COLOR color, bool blend)
+{
+  if (!ezal_private_blit_clip(&x, &y, &w, &h))
+  {
+    return true;
+  }
+
+  int format = al_get_bitmap_format(target);
+  uint32_t pixel = ezal_private_blit_color(color, format);
+  if (blend && (pixel >> 24) == 0xFF)
+  {
+    blend = false;
+  }
+  if (blend && pixel == 0)
+  {
+    return true;
+  }
+
+  ALLEGRO_LOCKED_REGION* region = al_lock_bitmap_region(
+    target,
+    x,
+    y,
+    w,
+    h,
+    ALLEGRO_PIXEL_FORMAT_ANY,
+    blend ? ALLEGRO_LOCK_READWRITE : ALLEGRO_LOCK_WRITEONLY);
+  if (!region)
+  {
+    return false;
+  }
+
+  for (int row = 0; row < h; row++)
+  {
+    uint32_t* dst = (uint32_t*)((unsigned char*)region->data + row * region->pitch);
+    if (blend)
+    {
+      ezal_private_blit.blend_fill(dst, w, pixel);
+    }
+    else
+    {
+      ezal_private_blit.fill(dst, w, pixel);
+    }
+  }
+  al_unlock_bitmap(target);
+
+  return true;
+}
+
+// al_clear_to_color for memory targets
+bool ezal_private_soft_clear(ALLEGRO_COLOR color)
+{
+  ALLEGRO_BITMAP* target = ezal_private_blit_target();
+  if (!target)
+  {
+    return false;
+  }
+  return ezal_private_soft_fill(
+    target,
+    0,
+    0,
+    al_get_bitmap_width(target),
+    al_get_bitmap_height(target),
+    color,
+    false);
+}
+
+// al_draw_filled_rectangle for memory targets, covers the pixels whose
+// centers are inside the rectangle like the primitives addon does
+bool ezal_private_soft_filled_rectangle(float x1, float y1, float x2, float y2, ALLEGRO_COLOR color)
+{
+  ALLEGRO_BITMAP* target = ezal_private_blit_target();
+  int mode = target ? ezal_private_blit_mode() : EZAL_BLIT_MODE_NONE;
+  if (mode == EZAL_BLIT_MODE_NONE)
+  {
+    return false;
+  }
+
+  if (x2 < x1) { float t = x1; x1 = x2; x2 = t; }
+  if (y2 < y1) { float t = y1; y1 = y2; y2 = t; }
+  int left = (int)ceilf(x1 - 0.5f);
+  int top = (int)ceilf(y1 - 0.5f);
+  int right = (int)ceilf(x2 - 0.5f);
+  int bottom = (int)ceilf(y2 - 0.5f);
+
+  return ezal_private_soft_fill(
+    target,
+    left,
+    top,
+    right - left,
+    bottom - top,
+    color,
+    mode == EZAL_BLIT_MODE_BLEND);
+}
+
+bool ezal_private_blit_source_ok(ALLEGRO_BITMAP* source, ALLEGRO_BITMAP* target)
+{
+  return source != target &&
+    !al_get_parent_bitmap(source) &&
+    !al_get_parent_bitmap(target) &&
+    (al_get_bitmap_flags(source) & ALLEGRO_MEMORY_BITMAP) &&
+    !al_is_bitmap_locked(source) &&
+    al_get_bitmap_format(source) == al_get_bitmap_format(target);
+}
+
+// unscaled, unflipped blit of a source region for memory targets
+bool ezal_private_soft_blit(
+  ALLEGRO_BITMAP* source,
+  float sx,
+  float sy,
+  float sw,
+  float sh,
+  float dx,
+  float dy,
+  const ALLEGRO_COLOR* tint,
+  int flags)
+{
+  ALLEGRO_BITMAP* target = ezal_private_blit_target();
+  if (!target || flags != 0 ||
+    !ezal_private_is_integer(sx) || !ezal_private_is_integer(sy) ||
+    !ezal_private_is_integer(sw) || !ezal_private_is_integer(sh) ||
+    !ezal_private_is_integer(dx) || !ezal_private_is_integer(dy) ||
+    !ezal_private_blit_source_ok(source, target))
+  {
+    return false;
+  }
+
+  int mode = ezal_private_blit_mode();
+  int format = al_get_bitmap_format(target);
+  uint32_t tint_pixel = tint ? ezal_private_blit_color(*tint, format) : 0xFFFFFFFFu;
+  if (mode == EZAL_BLIT_MODE_NONE || (mode == EZAL_BLIT_MODE_COPY && tint_pixel != 0xFFFFFFFFu))
+  {
+    return false;
+  }
+
+  // clip the source region to the source, then the destination to the target
+  int src_x = (int)sx;
+  int src_y = (int)sy;
+  int w = (int)sw;
+  int h = (int)sh;
+  int dst_x = (int)dx;
+  int dst_y = (int)dy;
+  int source_width = al_get_bitmap_width(source);
+  int source_height = al_get_bitmap_height(source);
+  if (src_x < 0) { dst_x -= src_x; w += src_x; src_x = 0; }
+  if (src_y < 0) { dst_y -= src_y; h += src_y; src_y = 0; }
+  if (src_x + w > source_width) { w = source_width - src_x; }
+  if (src_y + h > source_height) { h = source_height - src_y; }
+
+  int x = dst_x;
+  int y = dst_y;
+  if (w <= 0 || h <= 0 || !ezal_private_blit_clip(&x, &y, &w, &h))
+  {
+    return true;
+  }
+  src_x += x - dst_x;
+  src_y += y - dst_y;
+
+  ALLEGRO_LOCKED_REGION* src_region = al_lock_bitmap_region(
+    source,
+    src_x,
+    src_y,
+    w,
+    h,
+    ALLEGRO_PIXEL_FORMAT_ANY,
+    ALLEGRO_LOCK_READONLY);
+  if (!src_region)
+  {
+    return false;
+  }
+  ALLEGRO_LOCKED_REGION* dst_region = al_lock_bitmap_region(
+    target,
+    x,
+    y,
+    w,
+    h,
+    ALLEGRO_PIXEL_FORMAT_ANY,
+    mode == EZAL_BLIT_MODE_COPY ? ALLEGRO_LOCK_WRITEONLY : ALLEGRO_LOCK_READWRITE);
+  if (!dst_region)
+  {
+    al_unlock_bitmap(source);
+    return false;
+  }
+
+  for (int row = 0; row < h; row++)
+  {
+    const uint32_t* src = (const uint32_t*)((const unsigned char*)src_region->data + row * src_region->pitch);
+    uint32_t* dst = (uint32_t*)((unsigned char*)dst_region->data + row * dst_region->pitch);
+    if (mode == EZAL_BLIT_MODE_COPY)
+    {
+      ezal_private_blit.copy(dst, src, w);
+    }
+    else if (tint_pixel != 0xFFFFFFFFu)
+    {
+      ezal_private_blit.tint_blend(dst, src, w, tint_pixel);
+    }
+    else
+    {
+      ezal_private_blit.blend(dst, src, w);
+    }
+  }
+
+  al_unlock_bitmap(target);
+  al_unlock_bitmap(source);
+
+  return true;
+}
+
+// nearest neighbour scaled blit for memory targets
+bool ezal_private_soft_scaled_blit(
+  ALLEGRO_BITMAP* source,
+  float sx,
+  float sy,
+  float sw,
+  float sh,
+  float dx,
+  float dy,
+  float dw,
+  float dh,
+  int flags)
+{
+  ALLEGRO_BITMAP* target = ezal_private_blit_target();
+  if (!target || flags != 0 ||
+    !ezal_private_is_integer(dx) || !ezal_private_is_integer(dy) ||
+    !ezal_private_is_integer(dw) || !ezal_private_is_integer(dh) ||
+    dw <= 0.0f || dh <= 0.0f || sw <= 0.0f || sh <= 0.0f ||
+    (al_get_bitmap_flags(source) & (ALLEGRO_MIN_LINEAR | ALLEGRO_MAG_LINEAR)) ||
+    !ezal_private_blit_source_ok(source, target))
+  {
+    return false;
+  }
+
+  int mode = ezal_private_blit_mode();
+  if (mode == EZAL_BLIT_MODE_NONE)
+  {
+    return false;
+  }
+
+  // every sample has to land inside the source
+  int source_width = al_get_bitmap_width(source);
+  int source_height = al_get_bitmap_height(source);
+  if (sx < 0.0f || sy < 0.0f || sx + sw > (float)source_width || sy + sh > (float)source_height)
+  {
+    return false;
+  }
+
+  int dst_x = (int)dx;
+  int dst_y = (int)dy;
+  int x = dst_x;
+  int y = dst_y;
+  int w = (int)dw;
+  int h = (int)dh;
+  if (!ezal_private_blit_clip(&x, &y, &w, &h))
+  {
+    return true;
+  }
+
+  int index_stack[EZAL_BLIT_STACK_ROW];
+  uint32_t row_stack[EZAL_BLIT_STACK_ROW];
+  int* index = index_stack;
+  uint32_t* row_pixels = row_stack;
+  if (w > EZAL_BLIT_STACK_ROW)
+  {
+    index = (int*)malloc((size_t)w * sizeof(int));
+    row_pixels = (uint32_t*)malloc((size_t)w * sizeof(uint32_t));
+    if (!index || !row_pixels)
+    {
+      free(index);
+      free(row_pixels);
+      return false;
+    }
+  }
+
+  // sample at the pixel centers
+  float step_x = sw / dw;
+  float step_y = sh / dh;
+  for (int i = 0; i < w; i++)
+  {
+    int column = (int)(sx + ((float)(x - dst_x + i) + 0.5f) * step_x);
+    index[i] = column < source_width ? column : source_width - 1;
+  }
+
+  bool locked = false;
+  ALLEGRO_LOCKED_REGION* src_region = al_lock_bitmap(source, ALLEGRO_PIXEL_FORMAT_ANY, ALLEGRO_LOCK_READONLY);
+  if (src_region)
+  {
+    ALLEGRO_LOCKED_REGION* dst_region = al_lock_bitmap_region(
+      target,
+      x,
+      y,
+      w,
+      h,
+      ALLEGRO_PIXEL_FORMAT_ANY,
+      mode == EZAL_BLIT_MODE_COPY ? ALLEGRO_LOCK_WRITEONLY : ALLEGRO_LOCK_READWRITE);
+    if (dst_region)
+    {
+      locked = true;
+      for (int row = 0; row < h; row++)
+      {
+        int line = (int)(sy + ((float)(y - dst_y + row) + 0.5f) * step_y);
+        if (line >= source_height)
+        {
+          line = source_height - 1;
+        }
+        const uint32_t* src = (const uint32_t*)((const unsigned char*)src_region->data + line * src_region->pitch);
+        uint32_t* dst = (uint32_t*)((unsigned char*)dst_region->data + row * dst_region->pitch);
+        if (mode == EZAL_BLIT_MODE_COPY)
+        {
+          ezal_private_blit.gather(dst, src, index, w);
+        }
+        else
+        {
+          ezal_private_blit.gather(row_pixels, src, index, w);
+          ezal_private_blit.blend(dst, row_pixels, w);
+        }
+      }
+      al_unlock_bitmap(target);
+    }
+    al_unlock_bitmap(source);
+  }
+
+  if (index != index_stack)
+  {
+    free(index);
+    free(row_pixels);
+  }
+
+  return locked;
+}
+
+// copies a memory bitmap into a video bitmap of the same size so it can
+// be scaled on the gpu instead of through the software path
+bool ezal_private_upload_bitmap(ALLEGRO_BITMAP* source, ALLEGRO_BITMAP* upload)
+{
+  int format = al_get_bitmap_format(source);
+  int height = al_get_bitmap_height(source);
+  int row_size = al_get_bitmap_width(source) * al_get_pixel_size(format);
+
+  ALLEGRO_LOCKED_REGION* src_region = al_lock_bitmap(source, format, ALLEGRO_LOCK_READONLY);
+  if (!src_region)
+  {
+    return false;
+  }
+  ALLEGRO_LOCKED_REGION* dst_region = al_lock_bitmap(upload, format, ALLEGRO_LOCK_WRITEONLY);
+  if (!dst_region)
+  {
+    al_unlock_bitmap(source);
+    return false;
+  }
+
+  for (int row = 0; row < height; row++)
+  {
+    memcpy(
+      (unsigned char*)dst_region->data + row * dst_region->pitch,
+      (const unsigned char*)src_region->data + row * src_region->pitch,
+      row_size);
+  }
+
+  al_unlock_bitmap(upload);
+  al_unlock_bitmap(source);
+
+  return true;
+}
+
+// grid navigation
+
+static const int ezal_private_nav_dx[8] = { 1, -1, 0, 0, 1, -1, 1, -1 };
+static const int ezal_private_nav_dy[8] = { 0, 0, 1, -1, 1, 1, -1, -1 };
+
+uint32_t ezal_private_nav_heuristic(struct EZALNavGrid* grid, int x, int y, int goal_x, int goal_y)
+{
+  int dx = abs(x - goal_x);
+  int dy = abs(y - goal_y);
+  if (!grid->diagonal)
+  {
+    return (uint32_t)(EZAL_NAV_STRAIGHT * (dx + dy));
+  }
+  int lo = dx < dy ? dx : dy;
+  int hi = dx < dy ? dy : dx;
+  return (uint32_t)(EZAL_NAV_STRAIGHT * (hi - lo) + EZAL_NAV_DIAGONAL * lo);
+}
+
+// returns the cost of stepping from x, y in direction k, 0 when the step
+// leaves the grid, enters a blocked cell or cuts a blocked corner
+uint32_t ezal_private_nav_step(struct EZALNavGrid* grid, int x, int y, int k, int* neighbour)
+{
+  int nx = x + ezal_private_nav_dx[k];
+  int ny = y + ezal_private_nav_dy[k];
+  if (nx < 0 || ny < 0 || nx >= grid->width || ny >= grid->height)
+  {
+    return 0;
+  }
+
+  int cell = y * grid->width + x;
+  int n = ny * grid->width + nx;
+  if (!grid->cost[n])
+  {
+    return 0;
+  }
+
+  if (k >= 4)
+  {
+    if (!grid->cost[cell + ezal_private_nav_dx[k]] ||
+      !grid->cost[cell + ezal_private_nav_dy[k] * grid->width])
+    {
+      return 0;
+    }
+  }
+
+  *neighbour = n;
+  return (k < 4 ? EZAL_NAV_STRAIGHT : EZAL_NAV_DIAGONAL) * (uint32_t)grid->cost[n];
+}
+
+// open list, a binary heap of cell indices ordered by f
+// ties go to the higher g, which is the node closer to the goal
+
+bool ezal_private_nav_before(struct EZALNavNode* a, struct EZALNavNode* b)
+{
+  return a->f < b->f || (a->f == b->f && a->g > b->g);
+}
+
+void ezal_private_nav_sift_up(struct EZALNavSearch* search, int pos)
+{
+  int32_t cell = search->open[pos];
+  struct EZALNavNode* node = &search->nodes[cell];
+  while (pos > 0)
+  {
+    int parent = (pos - 1) >> 1;
+    int32_t other = search->open[parent];
+    if (!ezal_private_nav_before(node, &search->nodes[other]))
+    {
+      break;
+    }
+    search->open[pos] = other;
+    search->nodes[other].heap = pos;
+    pos = parent;
+  }
+  search->open[pos] = cell;
+  node->heap = pos;
+}
+
+void ezal_private_nav_sift_down(struct EZALNavSearch* search, int pos)
+{
+  int32_t cell = search->open[pos];
+  struct EZALNavNode* node = &search->nodes[cell];
+  for (;;)
+  {
+    int child = pos * 2 + 1;
+    if (child >= search->open_count)
+    {
+      break;
+    }
+    if (child + 1 < search->open_count &&
+      ezal_private_nav_before(&search->nodes[search->open[child + 1]], &search->nodes[search->open[child]]))
+    {
+      child++;
+    }
+    int32_t other = search->open[child];
+    if (!ezal_private_nav_before(&search->nodes[other], node))
+    {
+      break;
+    }
+    search->open[pos] = other;
+    search->nodes[other].heap = pos;
+    pos = child;
+  }
+  search->open[pos] = cell;
+  node->heap = pos;
+}
+
+void ezal_private_nav_push(struct EZALNavSearch* search, int32_t cell)
+{
+  search->open[search->open_count] = cell;
+  search->open_count++;
+  ezal_private_nav_sift_up(search, search->open_count - 1);
+}
+
+int32_t ezal_private_nav_pop(struct EZALNavSearch* search)
+{
+  int32_t cell = search->open[0];
+  search->open_count--;
+  if (search->open_count > 0)
+  {
+    search->open[0] = search->open[search->open_count];
+    ezal_private_nav_sift_down(search, 0);
+  }
+  search->nodes[cell].heap = -1;
+  return cell;
+}
+
+bool ezal_private_nav_search_alloc(struct EZALNavGrid* grid, struct EZALNavSearch* search)
+{
+  if (search->nodes)
+  {
+    return true;
+  }
+
+  search->nodes = (struct EZALNavNode*)calloc((size_t)grid->cells, sizeof(struct EZALNavNode));
+  search->open = (int32_t*)malloc((size_t)grid->cells * sizeof(int32_t));
+  if (!search->nodes || !search->open)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_NAV, "could not allocate search space for a %dx%d grid", grid->width, grid->height);
+    free(search->nodes);
+    free(search->open);
+    search->nodes = 0;
+    search->open = 0;
+    return false;
+  }
+  search->visit = 0;
+  return true;
+}
+
+void ezal_private_nav_search_begin(struct EZALNavSearch* search, int cells)
+{
+  search->visit++;
+  if (!search->visit)
+  {
+    memset(search->nodes, 0, (size_t)cells * sizeof(struct EZALNavNode));
+    search->visit = 1;
+  }
+  search->open_count = 0;
+}
+
+// A* from start to goal, returns true when goal was reached
+// the heuristic never overestimates and is consistent, so a closed cell
+// is never reopened
+bool ezal_private_nav_astar(struct EZALNavGrid* grid, struct EZALNavSearch* search, int start, int goal)
+{
+  int directions = grid->diagonal ? 8 : 4;
+  int goal_x = goal % grid->width;
+  int goal_y = goal / grid->width;
+
+  ezal_private_nav_search_begin(search, grid->cells);
+
+  struct EZALNavNode* first = &search->nodes[start];
+  first->visit = search->visit;
+  first->g = 0;
+  first->f = ezal_private_nav_heuristic(grid, start % grid->width, start / grid->width, goal_x, goal_y);
+  first->parent = -1;
+  ezal_private_nav_push(search, start);
+
+  while (search->open_count)
+  {
+    int32_t cell = ezal_private_nav_pop(search);
+    search->expanded++;
+    if (cell == goal)
+    {
+      return true;
+    }
+
+    int x = cell % grid->width;
+    int y = cell / grid->width;
+    uint32_t g = search->nodes[cell].g;
+    for (int k = 0; k < directions; k++)
+    {
+      int n;
+      uint32_t step = ezal_private_nav_step(grid, x, y, k, &n);
+      if (!step)
+      {
+        continue;
+      }
+
+      struct EZALNavNode* node = &search->nodes[n];
+      if (node->visit != search->visit)
+      {
+        node->visit = search->visit;
+        node->g = g + step;
+        node->f = node->g + ezal_private_nav_heuristic(grid,
+          x + ezal_private_nav_dx[k],
+          y + ezal_private_nav_dy[k],
+          goal_x,
+          goal_y);
+        node->parent = cell;
+        ezal_private_nav_push(search, n);
+      }
+      else if (node->heap >= 0 && g + step < node->g)
+      {
+        node->f -= node->g - (g + step);
+        node->g = g + step;
+        node->parent = cell;
+        ezal_private_nav_sift_up(search, node->heap);
+      }
+    }
+  }
+
+  return false;
+}
+
+// walks the parents back from goal and writes the first max_length
+// steps of the path, returns the full length
+int ezal_private_nav_write_path(
+  struct EZALNavGrid* grid,
+  struct EZALNavSearch* search,
+  int goal,
+  struct EZALNavPoint* path,
+  int max_length)
+{
+  int length = 0;
+  for (int32_t cell = goal; search->nodes[cell].parent >= 0; cell = search->nodes[cell].parent)
+  {
+    length++;
+  }
+
+  int32_t cell = goal;
+  for (int i = length - 1; i >= 0; i--)
+  {
+    if (i < max_length)
+    {
+      path[i].x = cell % grid->width;
+      path[i].y = cell / grid->width;
+    }
+    cell = search->nodes[cell].parent;
+  }
+
+  return length;
+}
+
+// path cache
+
+void ezal_private_nav_cache_clear(struct EZALNavGrid* grid)
+{
+  for (int i = 0; i < EZAL_NAV_CACHE_SIZE; i++)
+  {
+    if (grid->cache.entries[i].start >= 0)
+    {
+      grid->cache.entries[i].start = -1;
+      grid->stats.invalidated++;
+    }
+  }
+}
+
+// drops the cached paths that went through a region that got more
+// expensive, or all of them when a cell got cheaper
+void ezal_private_nav_cache_sync(struct EZALNavGrid* grid)
+{
+  if (grid->flush)
+  {
+    ezal_private_nav_cache_clear(grid);
+  }
+  else if (grid->dirty_any)
+  {
+    for (int i = 0; i < EZAL_NAV_CACHE_SIZE; i++)
+    {
+      struct EZALNavCacheEntry* entry = &grid->cache.entries[i];
+      if (entry->start < 0)
+      {
+        continue;
+      }
+      uint64_t* regions = grid->cache.regions + (size_t)i * grid->region_words;
+      for (int w = 0; w < grid->region_words; w++)
+      {
+        if (regions[w] & grid->dirty[w])
+        {
+          entry->start = -1;
+          grid->stats.invalidated++;
+          break;
+        }
+      }
+    }
+  }
+
+  if (grid->flush || grid->dirty_any)
+  {
+    memset(grid->dirty, 0, (size_t)grid->region_words * sizeof(uint64_t));
+    grid->flush = false;
+    grid->dirty_any = false;
+  }
+}
+
+int ezal_private_nav_cache_set(int start, int goal)
+{
+  uint32_t hash = (uint32_t)start * 0x9E3779B1u ^ (uint32_t)goal * 0x85EBCA77u;
+  hash ^= hash >> 16;
+  return (int)(hash & (EZAL_NAV_CACHE_SIZE / EZAL_NAV_CACHE_WAYS - 1)) * EZAL_NAV_CACHE_WAYS;
+}
+
+struct EZALNavCacheEntry* ezal_private_nav_cache_find(struct EZALNavGrid* grid, int start, int goal)
+{
+  struct EZALNavCacheEntry* set = &grid->cache.entries[ezal_private_nav_cache_set(start, goal)];
+  for (int i = 0; i < EZAL_NAV_CACHE_WAYS; i++)
+  {
+    if (set[i].start == start && set[i].goal == goal)
+    {
+      set[i].last_use = ++grid->cache.clock;
+      return &set[i];
+    }
+  }
+  return 0;
+}
+
+int ezal_private_nav_region(struct EZALNavGrid* grid, int x, int y)
+{
+  return (y / EZAL_NAV_REGION_SIZE) * grid->region_columns + x / EZAL_NAV_REGION_SIZE;
+}
+
+// stores a complete path, replacing the least recently used entry of
+// its set
+void ezal_private_nav_cache_store(
+  struct EZALNavGrid* grid,
+  int start,
+  int goal,
+  const struct EZALNavPoint* path,
+  int length)
+{
+  int first = ezal_private_nav_cache_set(start, goal);
+  int index = first;
+  for (int i = first; i < first + EZAL_NAV_CACHE_WAYS; i++)
+  {
+    if (grid->cache.entries[i].start < 0)
+    {
+      index = i;
+      break;
+    }
+    if (grid->cache.entries[i].last_use < grid->cache.entries[index].last_use)
+    {
+      index = i;
+    }
+  }
+
+  struct EZALNavCacheEntry* entry = &grid->cache.entries[index];
+  entry->start = -1;
+
+  if (length > entry->capacity)
+  {
+    int capacity = entry->capacity ? entry->capacity : 32;
+    while (capacity < length)
+    {
+      capacity *= 2;
+    }
+    struct EZALNavPoint* points = (struct EZALNavPoint*)realloc(entry->points, (size_t)capacity * sizeof(struct EZALNavPoint));
+    if (!points)
+    {
+      return;
+    }
+    entry->points = points;
+    entry->capacity = capacity;
+  }
+
+  uint64_t* regions = grid->cache.regions + (size_t)index * grid->region_words;
+  memset(regions, 0, (size_t)grid->region_words * sizeof(uint64_t));
+  int x = start % grid->width;
+  int y = start / grid->width;
+  int region = ezal_private_nav_region(grid, x, y);
+  regions[region >> 6] |= (uint64_t)1 << (region & 63);
+  for (int i = 0; i < length; i++)
+  {
+    entry->points[i] = path[i];
+    region = ezal_private_nav_region(grid, path[i].x, path[i].y);
+    regions[region >> 6] |= (uint64_t)1 << (region & 63);
+
+    // a diagonal step also depends on its two corner cells, which can
+    // sit in a region the path never enters
+    if (path[i].x != x && path[i].y != y)
+    {
+      region = ezal_private_nav_region(grid, path[i].x, y);
+      regions[region >> 6] |= (uint64_t)1 << (region & 63);
+      region = ezal_private_nav_region(grid, x, path[i].y);
+      regions[region >> 6] |= (uint64_t)1 << (region & 63);
+    }
+    x = path[i].x;
+    y = path[i].y;
+  }
+
+  entry->start = start;
+  entry->goal = goal;
+  entry->length = length;
+  entry->last_use = ++grid->cache.clock;
+}
+
+// connected areas
+
+// labels the connected areas of walkable cells with a flood fill, using
+// the open list of the first search as the queue
+// diagonal moves never cut a blocked corner, so they connect nothing that
+// straight moves don't and 4 way connectivity is exact for both modes
+void ezal_private_nav_label(struct EZALNavGrid* grid)
+{
+  int32_t* queue = grid->searches[0].open;
+  int32_t label = 0;
+
+  for (int i = 0; i < grid->cells; i++)
+  {
+    grid->component[i] = -1;
+  }
+
+  for (int i = 0; i < grid->cells; i++)
+  {
+    if (!grid->cost[i] || grid->component[i] >= 0)
+    {
+      continue;
+    }
+
+    int head = 0;
+    int tail = 0;
+    grid->component[i] = label;
+    queue[tail++] = i;
+    while (head < tail)
+    {
+      int32_t cell = queue[head++];
+      int x = cell % grid->width;
+      int y = cell / grid->width;
+      for (int k = 0; k < 4; k++)
+      {
+        int n;
+        if (ezal_private_nav_step(grid, x, y, k, &n) && grid->component[n] < 0)
+        {
+          grid->component[n] = label;
+          queue[tail++] = n;
+        }
+      }
+    }
+    label++;
+  }
+
+  grid->components_dirty = false;
+}
+
+// queries
+
+// answers a query without searching when it is invalid, trivial,
+// unreachable or cached, returns false when it needs a search
+bool ezal_private_nav_resolve(struct EZALNavGrid* grid, struct EZALNavQuery* query)
+{
+  grid->stats.queries++;
+
+  if (query->start_x < 0 || query->start_y < 0 || query->start_x >= grid->width || query->start_y >= grid->height ||
+    query->goal_x < 0 || query->goal_y < 0 || query->goal_x >= grid->width || query->goal_y >= grid->height)
+  {
+    query->length = EZAL_NAV_NO_PATH;
+    return true;
+  }
+
+  int start = query->start_y * grid->width + query->start_x;
+  int goal = query->goal_y * grid->width + query->goal_x;
+  if (!grid->cost[goal])
+  {
+    query->length = EZAL_NAV_NO_PATH;
+    return true;
+  }
+  if (start == goal)
+  {
+    query->length = 0;
+    return true;
+  }
+
+  // a blocked start may still step out onto a neighbour, so only walkable
+  // starts can be ruled out here
+  if (grid->cost[start])
+  {
+    if (grid->components_dirty)
+    {
+      ezal_private_nav_label(grid);
+    }
+    if (grid->component[start] != grid->component[goal])
+    {
+      grid->stats.unreachable++;
+      query->length = EZAL_NAV_NO_PATH;
+      return true;
+    }
+  }
+
+  struct EZALNavCacheEntry* entry = ezal_private_nav_cache_find(grid, start, goal);
+  if (!entry)
+  {
+    return false;
+  }
+
+  grid->stats.cache_hits++;
+  query->length = entry->length;
+  if (entry->length > 0 && query->path)
+  {
+    int count = entry->length < query->max_length ? entry->length : query->max_length;
+    memcpy(query->path, entry->points, (size_t)count * sizeof(struct EZALNavPoint));
+  }
+  return true;
+}
+
+// runs the search for a query, safe to call from several threads at once
+// as long as each uses its own search
+void ezal_private_nav_solve(struct EZALNavGrid* grid, struct EZALNavSearch* search, struct EZALNavQuery* query)
+{
+  int start = query->start_y * grid->width + query->start_x;
+  int goal = query->goal_y * grid->width + query->goal_x;
+
+  if (!ezal_private_nav_astar(grid, search, start, goal))
+  {
+    query->length = EZAL_NAV_NO_PATH;
+    return;
+  }
+
+  query->length = ezal_private_nav_write_path(grid, search, goal, query->path, query->path ? query->max_length : 0);
+}
+
+// caches the result of a search, paths that did not fit the caller's
+// buffer are not complete and are left out
+void ezal_private_nav_finish(struct EZALNavGrid* grid, struct EZALNavQuery* query)
+{
+  grid->stats.searches++;
+  if (query->length == EZAL_NAV_NO_PATH)
+  {
+    grid->stats.unreachable++;
+  }
+  else if (query->length > (query->path ? query->max_length : 0))
+  {
+    return;
+  }
+
+  ezal_private_nav_cache_store(
+    grid,
+    query->start_y * grid->width + query->start_x,
+    query->goal_y * grid->width + query->goal_x,
+    query->path,
+    query->length);
+}
+
+// batch workers
+
+void ezal_private_nav_work(struct EZALNavPool* pool, int index)
+{
+  struct EZALNavGrid* grid = pool->grid;
+  struct EZALNavSearch* search = &grid->searches[index];
+
+  for (;;)
+  {
+    int i = atomic_fetch_add_explicit(&pool->next, 1, memory_order_relaxed);
+    if (i >= pool->pending_count)
+    {
+      break;
+    }
+    ezal_private_nav_solve(grid, search, &pool->queries[pool->pending[i]]);
+  }
+}
+
+void* ezal_private_nav_worker(ALLEGRO_THREAD* thread, void* arg)
+{
+  struct EZALNavWorker* worker = (struct EZALNavWorker*)arg;
+  struct EZALNavPool* pool = worker->pool;
+
+  for (;;)
+  {
+    al_lock_mutex(pool->mutex);
+    while (!pool->stopping && pool->batch == worker->batch)
+    {
+      al_wait_cond(pool->cond, pool->mutex);
+    }
+    if (pool->stopping)
+    {
+      al_unlock_mutex(pool->mutex);
+      break;
+    }
+    worker->batch = pool->batch;
+    al_unlock_mutex(pool->mutex);
+
+    ezal_private_nav_work(pool, worker->index);
+
+    al_lock_mutex(pool->mutex);
+    pool->busy--;
+    if (!pool->busy)
+    {
+      al_broadcast_cond(pool->cond);
+    }
+    al_unlock_mutex(pool->mutex);
+  }
+
+  return 0;
+}
+
+// starts the workers the first time a batch is big enough to share,
+// returns false when the batch has to run on the calling thread
+bool ezal_private_nav_pool_start(struct EZALNavPool* pool)
+{
+  if (pool->started)
+  {
+    return pool->worker_count > 0;
+  }
+  pool->started = true;
+
+  int count = al_get_cpu_count() - 1;
+  if (count > EZAL_NAV_MAX_WORKERS)
+  {
+    count = EZAL_NAV_MAX_WORKERS;
+  }
+  if (count < 1)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_NAV, "single cpu, path batches run on the calling thread");
+    return false;
+  }
+
+  pool->mutex = al_create_mutex();
+  pool->cond = al_create_cond();
+  if (!pool->mutex || !pool->cond)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_WARN, EZAL_LOG_CATEGORY_NAV, "al_create_mutex/al_create_cond failed, path batches run on the calling thread");
+    return false;
+  }
+
+  for (int i = 0; i < count; i++)
+  {
+    struct EZALNavWorker* worker = &pool->workers[pool->worker_count];
+    worker->pool = pool;
+    worker->index = pool->worker_count + 1;
+    worker->batch = pool->batch;
+    worker->thread = al_create_thread(&ezal_private_nav_worker, worker);
+    if (!worker->thread)
+    {
+      EZAL_LOG(EZAL_LOG_LEVEL_WARN, EZAL_LOG_CATEGORY_NAV, "al_create_thread(nav worker) failed.");
+      break;
+    }
+    al_start_thread(worker->thread);
+    pool->worker_count++;
+  }
+
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_NAV, "started %d path workers", pool->worker_count);
+  return pool->worker_count > 0;
+}
+
+void ezal_private_nav_pool_stop(struct EZALNavPool* pool)
+{
+  if (pool->worker_count)
+  {
+    al_lock_mutex(pool->mutex);
+    pool->stopping = true;
+    al_broadcast_cond(pool->cond);
+    al_unlock_mutex(pool->mutex);
+
+    for (int i = 0; i < pool->worker_count; i++)
+    {
+      al_join_thread(pool->workers[i].thread, 0);
+      al_destroy_thread(pool->workers[i].thread);
+      pool->workers[i].thread = 0;
+    }
+    pool->worker_count = 0;
+  }
+
+  if (pool->cond)
+  {
+    al_destroy_cond(pool->cond);
+    pool->cond = 0;
+  }
+  if (pool->mutex)
+  {
+    al_destroy_mutex(pool->mutex);
+    pool->mutex = 0;
+  }
+
+  free(pool->pending);
+  pool->pending = 0;
+  pool->pending_capacity = 0;
+  pool->started = false;
+  pool->stopping = false;
+}
+
+// searches the pending queries, on the workers and the calling thread
+// when there are enough of them
+void ezal_private_nav_run_batch(struct EZALNavPool* pool, struct EZALNavGrid* grid, struct EZALNavQuery* queries)
+{
+  bool parallel = pool->pending_count >= EZAL_NAV_PARALLEL_MIN && ezal_private_nav_pool_start(pool);
+  for (int i = 1; parallel && i <= pool->worker_count; i++)
+  {
+    parallel = ezal_private_nav_search_alloc(grid, &grid->searches[i]);
+  }
+
+  pool->grid = grid;
+  pool->queries = queries;
+  atomic_store(&pool->next, 0);
+
+  if (!parallel)
+  {
+    ezal_private_nav_work(pool, 0);
+    return;
+  }
+
+  al_lock_mutex(pool->mutex);
+  pool->busy = pool->worker_count;
+  pool->batch++;
+  al_broadcast_cond(pool->cond);
+  al_unlock_mutex(pool->mutex);
+
+  ezal_private_nav_work(pool, 0);
+
+  al_lock_mutex(pool->mutex);
+  while (pool->busy)
+  {
+    al_wait_cond(pool->cond, pool->mutex);
+  }
+  al_unlock_mutex(pool->mutex);
+}
+
+// flow fields
+
+// Dijkstra outwards from the goal, stepping from a cell onto a
+// neighbour costs what the step from the neighbour onto the cell costs
+// every cell ends up pointing at the neighbour it was reached from,
+// which is its next step towards the goal
+void ezal_private_nav_flood(struct EZALNavGrid* grid, struct EZALNavSearch* search, struct EZALFlowField* field)
+{
+  int directions = grid->diagonal ? 8 : 4;
+
+  ezal_private_nav_search_begin(search, grid->cells);
+
+  struct EZALNavNode* first = &search->nodes[field->goal];
+  first->visit = search->visit;
+  first->g = 0;
+  first->f = 0;
+  first->parent = -1;
+  ezal_private_nav_push(search, field->goal);
+
+  while (search->open_count)
+  {
+    int32_t cell = ezal_private_nav_pop(search);
+    search->expanded++;
+
+    int x = cell % grid->width;
+    int y = cell / grid->width;
+    uint32_t g = search->nodes[cell].g;
+    uint32_t base = grid->cost[cell];
+    for (int k = 0; k < directions; k++)
+    {
+      int n;
+      if (!ezal_private_nav_step(grid, x, y, k, &n))
+      {
+        continue;
+      }
+
+      uint32_t step = (k < 4 ? EZAL_NAV_STRAIGHT : EZAL_NAV_DIAGONAL) * base;
+      struct EZALNavNode* node = &search->nodes[n];
+      if (node->visit != search->visit)
+      {
+        node->visit = search->visit;
+        node->g = g + step;
+        node->f = node->g;
+        node->parent = cell;
+        ezal_private_nav_push(search, n);
+      }
+      else if (node->heap >= 0 && g + step < node->g)
+      {
+        node->g = g + step;
+        node->f = node->g;
+        node->parent = cell;
+        ezal_private_nav_sift_up(search, node->heap);
+      }
+    }
+  }
+
+  // directions are stored as (dy + 1) * 3 + (dx + 1), 4 means stay
+  for (int cell = 0; cell < grid->cells; cell++)
+  {
+    struct EZALNavNode* node = &search->nodes[cell];
+    if (node->visit != search->visit)
+    {
+      field->distance[cell] = UINT32_MAX;
+      field->direction[cell] = 4;
+
+      // an agent stuck on a blocked cell still gets a way off it
+      for (int k = 0; !grid->cost[cell] && k < directions; k++)
+      {
+        int n;
+        uint32_t step = ezal_private_nav_step(grid, cell % grid->width, cell / grid->width, k, &n);
+        if (step && search->nodes[n].visit == search->visit &&
+          search->nodes[n].g + step < field->distance[cell])
+        {
+          field->distance[cell] = search->nodes[n].g + step;
+          field->direction[cell] = (unsigned char)((ezal_private_nav_dy[k] + 1) * 3 + ezal_private_nav_dx[k] + 1);
+        }
+      }
+      continue;
+    }
+
+    field->distance[cell] = node->g;
+    if (node->parent < 0)
+    {
+      field->direction[cell] = 4;
+    }
+    else
+    {
+      int dx = node->parent % grid->width - cell % grid->width;
+      int dy = node->parent / grid->width - cell / grid->width;
+      field->direction[cell] = (unsigned char)((dy + 1) * 3 + dx + 1);
+    }
+  }
+}
+
+void ezal_private_nav_free_field(struct EZALFlowField* field)
+{
+  free(field->distance);
+  free(field->direction);
+  free(field);
+}
+
+void ezal_private_nav_free_grid(struct EZALNavGrid* grid)
+{
+  while (grid->fields)
+  {
+    struct EZALFlowField* field = grid->fields;
+    grid->fields = field->next;
+    ezal_private_nav_free_field(field);
+  }
+
+  for (int i = 0; i < EZAL_NAV_MAX_WORKERS + 1; i++)
+  {
+    free(grid->searches[i].nodes);
+    free(grid->searches[i].open);
+  }
+
+  for (int i = 0; i < EZAL_NAV_CACHE_SIZE; i++)
+  {
+    free(grid->cache.entries[i].points);
+  }
+
+  free(grid->component);
+
+  free(grid->cache.regions);
+  free(grid->dirty);
+  free(grid->cost);
+  free(grid);
+}
+
+// stops the workers and frees every grid that is still around
+void ezal_private_nav_release(struct EZALNavContext* nav)
+{
+  ezal_private_nav_pool_stop(&nav->pool);
+
+  int count = 0;
+  while (nav->grids)
+  {
+    struct EZALNavGrid* grid = nav->grids;
+    nav->grids = grid->next;
+    ezal_private_nav_free_grid(grid);
+    count++;
+  }
+  if (count)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_NAV, "destroyed %d navigation grids", count);
+  }
+}
+
+// asset archives
+
+bool ezal_private_archive_map(struct EZALArchive* archive, const char* filename)
+{
+#if defined(EZAL_ARCHIVE_MMAP)
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ASSET, "open(%s) failed.", filename);
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ASSET, "fstat(%s) failed.", filename);
+    close(fd);
+    return false;
+  }
+
+  void* base = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ASSET, "mmap(%s) failed.", filename);
+    return false;
+  }
+
+  archive->base = (unsigned char*)base;
+  archive->size = (size_t)st.st_size;
+  archive->mapped = true;
+  return true;
+#else
+  FILE* fp = fopen(filename, "rb");
+  if (!fp)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ASSET, "fopen(%s) failed.", filename);
+    return false;
+  }
+
+  long size = -1;
+  if (fseek(fp, 0, SEEK_END) == 0)
+  {
+    size = ftell(fp);
+  }
+  if (size <= 0 || fseek(fp, 0, SEEK_SET) != 0)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ASSET, "could not get the size of %s", filename);
+    fclose(fp);
+    return false;
+  }
+
+  archive->base = (unsigned char*)malloc((size_t)size);
+  if (!archive->base || fread(archive->base, 1, (size_t)size, fp) != (size_t)size)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ASSET, "could not read %s", filename);
+    free(archive->base);
+    archive->base = 0;
+    fclose(fp);
+    return false;
+  }
+  fclose(fp);
+
+  archive->size = (size_t)size;
+  archive->mapped = false;
+  return true;
+#endif
+}
+
+void ezal_private_archive_unmap(struct EZALArchive* archive)
+{
+  for (int i = 0; i < archive->sample_count; i++)
+  {
+    al_destroy_sample(archive->samples[i]);
+  }
+  free(archive->samples);
+  archive->samples = 0;
+  archive->sample_count = 0;
+  archive->sample_capacity = 0;
+
+  if (!archive->base)
+  {
+    return;
+  }
+#if defined(EZAL_ARCHIVE_MMAP)
+  munmap(archive->base, archive->size);
+#else
+  free(archive->base);
+#endif
+  archive->base = 0;
+  archive->size = 0;
+}
+
+// checks everything the loaders rely on once, so they can trust the
+// table of contents afterwards
+bool ezal_private_archive_validate(struct EZALArchive* archive, const char* filename)
+{
+  const struct EZALPackHeader* header = (const struct EZALPackHeader*)archive->base;
+  if (archive->size < sizeof(struct EZALPackHeader) ||
+    memcmp(header->magic, EZAL_PACK_MAGIC, sizeof(header->magic)) != 0)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ASSET, "%s is not an ezal archive", filename);
+    return false;
+  }
+  if (header->version != EZAL_PACK_VERSION)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ASSET, "%s is archive version %u, expected %u", filename, header->version, EZAL_PACK_VERSION);
+    return false;
+  }
+  if (header->byte_order != EZAL_PACK_BYTE_ORDER)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ASSET, "%s was packed on a machine with a different byte order", filename);
+    return false;
+  }
+
+  uint64_t toc_size = (uint64_t)header->entry_count * sizeof(struct EZALPackEntry);
+  if (header->size != archive->size ||
+    header->toc_offset % 8 != 0 ||
+    header->toc_offset > archive->size ||
+    toc_size > archive->size - header->toc_offset)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ASSET, "%s is truncated or damaged", filename);
+    return false;
+  }
+
+  archive->entries = (const struct EZALPackEntry*)(archive->base + header->toc_offset);
+  archive->count = (int)header->entry_count;
+
+  for (int i = 0; i < archive->count; i++)
+  {
+    const struct EZALPackEntry* entry = &archive->entries[i];
+    // loaders hand the data straight to Allegro, so hold every entry to
+    // the alignment the packer writes
+    bool ok = memchr(entry->name, 0, EZAL_PACK_NAME_MAX) != 0 &&
+      entry->offset >= sizeof(struct EZALPackHeader) &&
+      entry->offset % EZAL_PACK_ALIGN == 0 &&
+      entry->offset <= header->toc_offset &&
+      entry->size <= header->toc_offset - entry->offset &&
+      (i == 0 || strcmp(archive->entries[i - 1].name, entry->name) < 0);
+
+    if (ok && entry->type == EZAL_PACK_TYPE_BITMAP)
+    {
+      // al_get_pixel_size indexes a table, and the ANY formats and the
+      // compressed ones can't be locked and copied row by row
+      ok = entry->format > ALLEGRO_PIXEL_FORMAT_ANY_32_WITH_ALPHA &&
+        entry->format < ALLEGRO_NUM_PIXEL_FORMATS &&
+        al_get_pixel_block_width((int)entry->format) == 1;
+    }
+    if (ok && entry->type == EZAL_PACK_TYPE_BITMAP)
+    {
+      uint64_t row = (uint64_t)entry->a * (uint64_t)al_get_pixel_size((int)entry->format);
+      ok = entry->a > 0 && entry->b > 0 && row > 0 && entry->c >= row &&
+        entry->size >= (uint64_t)entry->c * entry->b;
+    }
+    else if (ok && entry->type == EZAL_PACK_TYPE_SAMPLE)
+    {
+      uint64_t frame = (uint64_t)al_get_channel_count((int)entry->b) * al_get_audio_depth_size((int)entry->format);
+      ok = entry->a > 0 && frame > 0 && entry->size >= (uint64_t)entry->c * frame;
+    }
+
+    if (!ok)
+    {
+      EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ASSET, "%s has a bad table of contents entry (%d)", filename, i);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+const struct EZALPackEntry* ezal_private_archive_find(struct EZALArchive* archive, const char* name, uint32_t type)
+{
+  const struct EZALPackEntry* entry = ezal_archive_find(archive, name);
+  if (!entry)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ASSET, "%s is not in the archive", name);
+    return 0;
+  }
+  if (entry->type != type)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ASSET, "%s has asset type %u, expected %u", name, entry->type, type);
+    return 0;
+  }
+  return entry;
+}
+
+// asks the kernel to start reading the pages of an asset before they
+// are touched
+void ezal_private_archive_prefetch(struct EZALArchive* archive, const struct EZALPackEntry* entry)
+{
+#if defined(EZAL_ARCHIVE_MMAP)
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  size_t start = (size_t)entry->offset & ~(page - 1);
+  madvise(archive->base + start, (size_t)(entry->offset + entry->size) - start, MADV_WILLNEED);
+#endif
+}
+
+void ezal_private_archives_release(struct EZALPrivateData* pd)
+{
+  int count = 0;
+  while (pd->archives)
+  {
+    struct EZALArchive* archive = pd->archives;
+    pd->archives = archive->next;
+    ezal_private_archive_unmap(archive);
+    free(archive);
+    count++;
+  }
+  if (count)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ASSET, "closed %d archives", count);
+  }
+}
+
+// frame rate and background throttling
+
+// works out the tick rate, render rate and pausing from the background
+// policy, throttling only lowers the render rate so the simulation keeps
+// its tick, slowing down also slows the frame timer so the process wakes
+// up less often
+void ezal_private_apply_throttle(struct EZALPrivateData* pd)
+{
+  int policy = pd->in_background
+    ? pd->cfg.background_policy
+    : EZAL_BACKGROUND_CONTINUE;
+
+  // throttling to 0 fps keeps updating without rendering, slowing down
+  // to 0 fps stops the timer
+  if (pd->cfg.background_frame_rate <= 0)
+  {
+    if (policy == EZAL_BACKGROUND_THROTTLE)
+    {
+      policy = EZAL_BACKGROUND_PAUSE_RENDER;
+    }
+    else if (policy == EZAL_BACKGROUND_SLOW_DOWN)
+    {
+      policy = EZAL_BACKGROUND_PAUSE;
+    }
+  }
+
+  bool pause_timer = policy == EZAL_BACKGROUND_PAUSE;
+  pd->render_paused = pd->drawing_halted ||
+    pause_timer ||
+    policy == EZAL_BACKGROUND_PAUSE_RENDER;
+
+  int tick_rate = pd->cfg.frame_rate;
+  int render_rate = pd->cfg.render_rate;
+  if (policy == EZAL_BACKGROUND_THROTTLE)
+  {
+    render_rate = pd->cfg.background_frame_rate;
+  }
+  else if (policy == EZAL_BACKGROUND_SLOW_DOWN)
+  {
+    // every slowed down tick is rendered
+    if (pd->cfg.background_frame_rate < tick_rate)
+    {
+      tick_rate = pd->cfg.background_frame_rate;
+    }
+    render_rate = 0;
+  }
+  pd->render_interval = render_rate > 0 ? 1.0 / (double)render_rate : 0.0;
+
+  if (pd->al_ctx.timer && tick_rate != pd->tick_rate)
+  {
+    al_set_timer_speed(pd->al_ctx.timer, 1.0 / (double)tick_rate);
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ALLEGRO, "al_set_timer_speed(%g)", 1.0 / (double)tick_rate);
+    pd->tick_rate = tick_rate;
+  }
+
+  if (pd->al_ctx.timer && pause_timer != pd->timer_paused)
+  {
+    if (pause_timer)
+    {
+      al_stop_timer(pd->al_ctx.timer);
+    }
+    else
+    {
+      al_resume_timer(pd->al_ctx.timer);
+    }
+    pd->timer_paused = pause_timer;
+  }
+
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_RUNTIME, "%s: render %s at %g fps, simulation %s at %d fps",
+    pd->in_background ? "background" : "foreground",
+    pd->render_paused ? "paused" : "running",
+    render_rate > 0 ? (double)render_rate : (double)tick_rate,
+    pd->timer_paused ? "paused" : "running",
+    tick_rate);
+}
+
+// decides if this tick gets rendered, called once the tick is updated
+bool ezal_private_should_render(struct EZALPrivateData* pd)
+{
+  if (pd->render_paused)
+  {
+    return false;
+  }
+
+  if (pd->render_interval <= 0.0)
+  {
+    return true;
+  }
+
+  // allow half a tick of jitter so 60/30 fps renders every other tick
+  double now = al_get_time();
+  double slack = 0.5 / (double)pd->tick_rate;
+  if (now - pd->last_render_time < pd->render_interval - slack)
+  {
+    return false;
+  }
+  pd->last_render_time = now;
+
+  return true;
+}
+
+bool ezal_private_set_frame_rate(struct EZALPrivateData* pd, int frame_rate)
+{
+  if (frame_rate <= 0)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_WARN, EZAL_LOG_CATEGORY_RUNTIME, "invalid frame rate %d", frame_rate);
+    return false;
+  }
+
+  // the timer speed is set by ezal_private_apply_throttle, which keeps it
+  // slowed down while the game is throttled in the background
+  pd->cfg.frame_rate = frame_rate;
+  ezal_private_apply_throttle(pd);
+
+  return true;
+}
+
+// ezal private function pointer targets
+void ezal_private_halt(struct EZALPrivateData* pd)
+{
+  pd->rt_ctx.is_running = false;
+  pd->rt_ctx.should_redraw = false;
+}
+
+void ezal_private_resize(struct EZALPrivateData* pd)
+{
+  if (!pd->al_ctx.display)
+  {
+    return;
+  }
+
+  int display_width = al_get_display_width(pd->al_ctx.display);
+  int display_height = al_get_display_height(pd->al_ctx.display);
+
+  pd->cfg.width = display_width;
+  pd->cfg.height = display_height;
+
+  if (pd->cfg.stretch_scale)
+  {
+    pd->x = 0;
+    pd->y = 0;
+    pd->w = display_width;
+    pd->h = display_height;
+  }
+  else
+  {
+    float ratio = (float)display_width / (float)pd->cfg.logical_width;
+
+    if (display_height < ((float)pd->cfg.logical_height * ratio))
+    {
+      ratio = (float)display_height / (float)pd->cfg.logical_height;
+    }
+
+    pd->w = pd->cfg.logical_width * ratio;
+    pd->h = pd->cfg.logical_height * ratio;
+    pd->x = (display_width - pd->w) * 0.5f;
+    pd->y = (display_height - pd->h) * 0.5f;
+  }
+}
+
+void ezal_private_update(struct EZALPrivateData* pd)
+{
+  al_wait_for_event(pd->al_ctx.event_queue, &pd->al_ctx.event);
+
+  switch (pd->al_ctx.event.type)
+  {
+    case ALLEGRO_EVENT_TIMER: {
+      pd->rt_ctx.should_redraw = true;
+
+      ezal_private_scheduler_advance(pd);
+      pd->rt_ctx.update(&pd->rt_ctx);
+
+      for (int i = 0; i < ALLEGRO_KEY_MAX; i++) {
+        pd->input.key[i] &= 1;
+      }
+      pd->input.mouse_state &= 1;
+    } break;
+    case ALLEGRO_EVENT_KEY_DOWN: {
+      pd->input.key[pd->al_ctx.event.keyboard.keycode] = 1 | 2;
+    } break;
+    case ALLEGRO_EVENT_KEY_UP: {
+      pd->input.key[pd->al_ctx.event.keyboard.keycode] &= 2;
+    } break;
+    case ALLEGRO_EVENT_MOUSE_AXES: {
+      pd->input.mouse_x = pd->al_ctx.event.mouse.x;
+      pd->input.mouse_y = pd->al_ctx.event.mouse.y;
+    } break;
+    case ALLEGRO_EVENT_MOUSE_BUTTON_DOWN: {
+      pd->input.mouse_state = 1 | 2;
+      pd->input.mouse_button = pd->al_ctx.event.mouse.button;
+    } break;
+    case ALLEGRO_EVENT_MOUSE_BUTTON_UP: {
+      pd->input.mouse_state &= 2;
+      pd->input.mouse_button = pd->al_ctx.event.mouse.button;
+    } break;
+    case ALLEGRO_EVENT_DISPLAY_CLOSE: {
+      pd->halt(pd);
+    } break;
+    case ALLEGRO_EVENT_DISPLAY_RESIZE: {
+      if (al_acknowledge_resize(pd->al_ctx.event.display.source))
+      {
+        pd->resize(pd);
+      }
+    } break;
+    case ALLEGRO_EVENT_DISPLAY_SWITCH_IN: {
+      pd->resize(pd);
+      ezal_private_promote_bitmaps(pd, "display switch in");
+      pd->in_background = false;
+      ezal_private_apply_throttle(pd);
+    } break;
+    case ALLEGRO_EVENT_DISPLAY_SWITCH_OUT: {
+      pd->in_background = true;
+      ezal_private_apply_throttle(pd);
+    } break;
+    case ALLEGRO_EVENT_DISPLAY_HALT_DRAWING: {
+      pd->drawing_halted = true;
+      ezal_private_apply_throttle(pd);
+      al_acknowledge_drawing_halt(pd->al_ctx.event.display.source);
+    } break;
+    case ALLEGRO_EVENT_DISPLAY_RESUME_DRAWING: {
+      al_acknowledge_drawing_resume(pd->al_ctx.event.display.source);
+      ezal_private_promote_bitmaps(pd, "display resume drawing");
+      pd->drawing_halted = false;
+      ezal_private_apply_throttle(pd);
+      pd->rt_ctx.should_redraw = true;
+    } break;
+    default: break;
+  }
+}
+
+void ezal_private_render_default(struct EZALPrivateData* pd)
+{
+  al_clear_to_color(pd->al_ctx.screen_color);
+}
+
+void ezal_private_present_default(struct EZALPrivateData* pd)
+{
+  if (pd->capture.active)
+  {
+    ezal_private_capture_frame(pd, al_get_backbuffer(pd->al_ctx.display));
+  }
+  al_flip_display();
+}
+
+void ezal_private_present_headless(struct EZALPrivateData* pd)
+{
+  if (pd->capture.active)
+  {
+    ezal_private_capture_frame(pd, pd->al_ctx.buffer);
+  }
+}
+
+void ezal_private_render_scaled(struct EZALPrivateData* pd)
+{
+  al_set_target_bitmap(pd->al_ctx.buffer);
+  if (!ezal_private_soft_clear(pd->al_ctx.screen_color))
+  {
+    al_clear_to_color(pd->al_ctx.screen_color);
+  }
+}
+
+// a memory buffer is uploaded to a video bitmap once per frame so the
+// scaling happens on the gpu
+ALLEGRO_BITMAP* ezal_private_present_source(struct EZALPrivateData* pd)
+{
+  ALLEGRO_BITMAP* buffer = pd->al_ctx.buffer;
+  if (!(al_get_bitmap_flags(buffer) & ALLEGRO_MEMORY_BITMAP) || pd->upload_failed)
+  {
+    return buffer;
+  }
+
+  if (!pd->upload)
+  {
+    int new_flags = al_get_new_bitmap_flags();
+    int new_format = al_get_new_bitmap_format();
+    al_set_new_bitmap_flags((new_flags & ~ALLEGRO_MEMORY_BITMAP) | ALLEGRO_VIDEO_BITMAP);
+    al_set_new_bitmap_format(al_get_bitmap_format(buffer));
+    pd->upload = al_create_bitmap(al_get_bitmap_width(buffer), al_get_bitmap_height(buffer));
+    al_set_new_bitmap_flags(new_flags);
+    al_set_new_bitmap_format(new_format);
+
+    if (!pd->upload)
+    {
+      pd->upload_failed = true;
+      EZAL_LOG(EZAL_LOG_LEVEL_WARN, EZAL_LOG_CATEGORY_RENDER, "could not create a video bitmap to upload the memory buffer to");
+      return buffer;
+    }
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_RENDER, "uploading the memory buffer to a video bitmap for presenting");
+  }
+
+  if (!ezal_private_upload_bitmap(buffer, pd->upload))
+  {
+    return buffer;
+  }
+
+  return pd->upload;
+}
+
+void ezal_private_present_scaled(struct EZALPrivateData* pd)
+{
+  if (pd->capture.active)
+  {
+    ezal_private_capture_frame(pd, pd->al_ctx.buffer);
+  }
+  ALLEGRO_BITMAP* source = ezal_private_present_source(pd);
+  al_set_target_backbuffer(pd->al_ctx.display);
+  // rgb(51 102 153)
+  al_clear_to_color(pd->al_ctx.border_color);
+  // al_clear_to_color(al_map_rgb(0, 0, 0));
+  al_draw_scaled_bitmap(
+    source,
+    0,
+    0,
+    pd->cfg.logical_width,
+    pd->cfg.logical_height,
+    pd->x,
+    pd->y,
+    pd->w,
+    pd->h,
+    0);
+  al_flip_display();
+}
+
+// private api functions
+
+// configuration
+void ezal_private_copy_config(struct EZALConfig* src, struct EZALConfig* dst)
+{
+  ezal_use_config_defaults(dst);
+
+  if (src == 0)
+  {
+    return;
+  }
+
+  memcpy(dst, src, sizeof(struct EZALConfig));
+}
+
+// settings that depend on each other or on how ezal was built
+void ezal_private_fixup_config(struct EZALPrivateData* pd)
+{
+#if defined(EZAL_STATIC_LOOP)
+  bool headless = EZAL_STATIC_LOOP == EZAL_LOOP_HEADLESS;
+  bool auto_scale = EZAL_STATIC_LOOP == EZAL_LOOP_SCALED || (headless && pd->cfg.auto_scale);
+  if (pd->cfg.headless != headless || pd->cfg.auto_scale != auto_scale)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_WARN, EZAL_LOG_CATEGORY_CORE, "ezal was built with a static %s loop, overriding the configuration",
+      headless ? "headless" : auto_scale ? "scaled" : "default");
+    pd->cfg.headless = headless;
+    pd->cfg.auto_scale = auto_scale;
+  }
+#endif
+
+  if (pd->cfg.headless)
+  {
+    pd->cfg.enable_keyboard = false;
+    pd->cfg.enable_mouse = false;
+  }
+}
+
+// initialization
+
+bool ezal_private_init_allegro(struct EZALPrivateData* pd)
+{
+  if (!al_init())
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ALLEGRO, "al_init failed.");
+    return false;
+  }
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ALLEGRO, "al_init");
+
+  ezal_private_log_start();
+
+  if (pd->cfg.enable_keyboard)
+  {
+    memset(pd->input.key, 0, sizeof(pd->input.key));
+    if (!al_install_keyboard())
+    {
+      EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_INPUT, "al_install_keyboard failed.");
+      return false;
+    }
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_INPUT, "al_install_keyboard");
+  }
+
+  if (pd->cfg.enable_mouse)
+  {
+    if (!al_install_mouse())
+    {
+      EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_INPUT, "al_install_mouse failed.");
+      return false;
+    }
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_INPUT, "al_install_mouse");
+  }
+
+  if (pd->cfg.enable_audio)
+  {
+    if (!al_install_audio())
+    {
+      EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_AUDIO, "al_install_audio failed.");
+      return false;
+    }
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_AUDIO, "al_install_audio");
+  }
+
+  double frame_rate = 1.0 / (double)pd->cfg.frame_rate;
+
+  pd->al_ctx.timer = 0;
+  ALLEGRO_TIMER* timer = al_create_timer(frame_rate);
+  if (!timer)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ALLEGRO, "al_create_timer(%g) failed.", frame_rate);
+    return false;
+  }
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ALLEGRO, "al_create_timer(%g)", frame_rate);
+  pd->al_ctx.timer = timer;
+
+  pd->al_ctx.event_queue = 0;
+  ALLEGRO_EVENT_QUEUE* event_queue = al_create_event_queue();
+  if (!event_queue)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ALLEGRO, "al_create_event_queue failed.");
+    return false;
+  }
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ALLEGRO, "al_create_event_queue");
+  pd->al_ctx.event_queue = event_queue;
+
+  pd->al_ctx.display = 0;
+  if (pd->cfg.headless)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ALLEGRO, "headless, no display created");
+    pd->w = pd->cfg.logical_width;
+    pd->h = pd->cfg.logical_height;
+  }
+  else
+  {
+    al_set_new_display_flags(pd->cfg.fullscreen
+      ? ALLEGRO_FULLSCREEN_WINDOW
+      : ALLEGRO_RESIZABLE);
+
+    ALLEGRO_DISPLAY* display = al_create_display(
+        pd->cfg.width,
+        pd->cfg.height);
+    if (!display)
+    {
+      EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ALLEGRO, "al_create_display(%d,%d) failed.",
+          pd->cfg.width,
+          pd->cfg.height);
+      return false;
+    }
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ALLEGRO, "al_create_display(%d,%d)", pd->cfg.width, pd->cfg.height);
+    pd->al_ctx.display = display;
+    pd->w = al_get_display_width(display);
+    pd->h = al_get_display_height(display);
+  }
+
+  pd->al_ctx.buffer = 0;
+  if (pd->cfg.auto_scale || pd->cfg.headless)
+  {
+    // without a display everything is rendered into a memory buffer
+    int new_flags = al_get_new_bitmap_flags();
+    if (pd->cfg.headless)
+    {
+      al_set_new_bitmap_flags((new_flags & ~ALLEGRO_VIDEO_BITMAP) | ALLEGRO_MEMORY_BITMAP);
+    }
+    ALLEGRO_BITMAP* buffer = al_create_bitmap(
+      pd->cfg.logical_width,
+      pd->cfg.logical_height);
+    al_set_new_bitmap_flags(new_flags);
+    if (!buffer)
+    {
+      EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ALLEGRO, "al_create_bitmap(%d,%d) failed.",
+          pd->cfg.logical_width,
+          pd->cfg.logical_height);
+      return false;
+    }
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ALLEGRO, "al_create_bitmap(%d,%d)", pd->cfg.logical_width, pd->cfg.logical_height);
+    if (!pd->cfg.headless && (al_get_bitmap_flags(buffer) & ALLEGRO_MEMORY_BITMAP))
+    {
+      EZAL_LOG(EZAL_LOG_LEVEL_WARN, EZAL_LOG_CATEGORY_BITMAP, "the logical buffer is a memory bitmap, scaling will use the slow software path");
+    }
+    pd->al_ctx.buffer = buffer;
+  }
+
+  if (!al_init_font_addon())
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ALLEGRO, "al_init_font_addon failed.");
+    return false;
+  }
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ALLEGRO, "al_init_font_addon");
+
+  if (!al_init_ttf_addon())
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ALLEGRO, "al_init_ttf_addon failed.");
+    return false;
+  }
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ALLEGRO, "al_init_ttf_addon");
+
+  if (!al_init_image_addon())
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ALLEGRO, "al_init_image_addon failed.");
+    return false;
+  }
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ALLEGRO, "al_init_image_addon");
+
+  if (!al_init_primitives_addon())
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ALLEGRO, "al_init_primitives_addon failed.");
+    return false;
+  }
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ALLEGRO, "al_init_primitives_addon");
+
+  if (pd->cfg.enable_audio)
+  {
+    if (!al_init_acodec_addon())
+    {
+      EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_AUDIO, "al_init_acodec_addon failed.");
+      return false;
+    }
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_AUDIO, "al_init_acodec_addon");
+
+    if (!al_reserve_samples(pd->cfg.audio_samples))
+    {
+      EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_AUDIO, "al_reserve_samples(%d) failed.",
+          pd->cfg.audio_samples);
+      return false;
+    }
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_AUDIO, "al_reserve_samples(%d)", pd->cfg.audio_samples);
+  }
+
+  pd->al_ctx.font = 0;
+  ALLEGRO_FONT* font = al_create_builtin_font();
+  if (!font)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ALLEGRO, "al_create_builtin_font failed.");
+    return false;
+  }
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ALLEGRO, "al_create_builtin_font");
+  pd->al_ctx.font = font;
+
+  pd->al_ctx.border_color = al_map_rgb(0, 0, 0);
+  pd->al_ctx.screen_color = al_map_rgb(51, 102, 153);
+
+  if (pd->cfg.enable_keyboard)
+  {
+    al_register_event_source(
+      pd->al_ctx.event_queue,
+      al_get_keyboard_event_source());
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_INPUT, "al_register_event_source(keyboard)");
+  }
+
+  if (pd->cfg.enable_mouse)
+  {
+    al_register_event_source(
+      pd->al_ctx.event_queue,
+      al_get_mouse_event_source());
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_INPUT, "al_register_event_source(mouse)");
+  }
+
+  if (pd->al_ctx.display)
+  {
+    al_register_event_source(
+      pd->al_ctx.event_queue,
+      al_get_display_event_source(pd->al_ctx.display));
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ALLEGRO, "al_register_event_source(display)");
+  }
+
+  al_register_event_source(
+    pd->al_ctx.event_queue,
+    al_get_timer_event_source(pd->al_ctx.timer));
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ALLEGRO, "al_register_event_source(timer)");
+
+  return true;
+}
+
+void ezal_runtime_do_nothing(struct EZALRuntimeContext* ctx)
+{
+
+}
+
+bool ezal_private_init_runtime(
+  struct EZALPrivateData* pd,
+  EZALFPTR create,
+  EZALFPTR destroy,
+  EZALFPTR update,
+  EZALFPTR render
+)
+{
+  pd->rt_ctx.cfg = &pd->cfg;
+  pd->rt_ctx.al_ctx = &pd->al_ctx;
+  pd->rt_ctx.input = &pd->input;
+  pd->rt_ctx._ezal_reserved = pd;
+
+  ezal_private_scheduler_init(&pd->scheduler);
+
+  if (!ezal_private_bitmaps_init(&pd->bitmaps))
+  {
+    return false;
+  }
+
+  pd->rt_ctx.create = &ezal_runtime_do_nothing;
+  pd->rt_ctx.destroy = &ezal_runtime_do_nothing;
+  pd->rt_ctx.update = &ezal_runtime_do_nothing;
+  pd->rt_ctx.render = &ezal_runtime_do_nothing;
+  pd->rt_ctx.post_render = &ezal_runtime_do_nothing;
+
+  if (create)
+  {
+    pd->rt_ctx.create = create;
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_RUNTIME, "using user create function");
+  }
+
+  if (destroy)
+  {
+    pd->rt_ctx.destroy = destroy;
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_RUNTIME, "using user destroy function");
+  }
+
+  if (update)
+  {
+    pd->rt_ctx.update = update;
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_RUNTIME, "using user update function");
+  }
+
+  if (render)
+  {
+    pd->rt_ctx.render = render;
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_RUNTIME, "using user render function");
+  }
+
+  return true;
+}
+
+bool ezal_private_init_pd(struct EZALPrivateData* pd)
+{
+  pd->resize = &ezal_private_resize;
+  pd->halt = &ezal_private_halt;
+  pd->update = &ezal_private_update;
+  pd->render = &ezal_private_render_default;
+  pd->present = &ezal_private_present_default;
+
+  if (pd->cfg.auto_scale)
+  {
+    pd->render = &ezal_private_render_scaled;
+    pd->present = &ezal_private_present_scaled;
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_RENDER, "auto scale enabled");
+  }
+
+  if (pd->cfg.headless)
+  {
+    pd->render = &ezal_private_render_scaled;
+    pd->present = &ezal_private_present_headless;
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_RENDER, "headless rendering enabled");
+  }
+
+  ezal_private_blit_init();
+  pd->upload = 0;
+  pd->upload_failed = false;
+
+  pd->in_background = false;
+  pd->drawing_halted = false;
+  pd->timer_paused = false;
+  pd->tick_rate = pd->cfg.frame_rate;
+  pd->last_render_time = 0.0;
+  ezal_private_apply_throttle(pd);
+
+  return true;
+}
+
+bool ezal_private_init(
+  struct EZALPrivateData* pd,
+  EZALFPTR create,
+  EZALFPTR destroy,
+  EZALFPTR update,
+  EZALFPTR render)
+{
+  ezal_private_fixup_config(pd);
+
+  // initialize allegro
+  if (!ezal_private_init_allegro(pd))
+  {
+    return false;
+  }
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ALLEGRO, "allegro initialization complete");
+
+  // initialize runtime
+  if (!ezal_private_init_runtime(pd, create, destroy, update, render))
+  {
+    return false;
+  }
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_RUNTIME, "runtime initialization complete");
+
+  // initialize pd private function pointers based on cfg
+  if (!ezal_private_init_pd(pd))
+  {
+    return false;
+  }
+
+  return true;
+}
+
+// shutdown
+bool ezal_private_quit(struct EZALPrivateData* pd)
+{
+  ezal_private_capture_stop(pd);
+  ezal_private_scheduler_release(&pd->scheduler);
+  ezal_private_bitmaps_release(&pd->bitmaps);
+  ezal_private_nav_release(&pd->nav);
+  ezal_private_archives_release(pd);
+
+  if (pd->al_ctx.font)
+  {
+    al_destroy_font(pd->al_ctx.font);
+    pd->al_ctx.font = 0;
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ALLEGRO, "al_destroy_font");
+  }
+
+  if (pd->upload)
+  {
+    al_destroy_bitmap(pd->upload);
+    pd->upload = 0;
+  }
+
+  if (pd->al_ctx.buffer)
+  {
+    al_destroy_bitmap(pd->al_ctx.buffer);
+    pd->al_ctx.buffer = 0;
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ALLEGRO, "al_destroy_bitmap");
+  }
+
+  if (pd->al_ctx.display)
+  {
+    al_destroy_display(pd->al_ctx.display);
+    pd->al_ctx.display = 0;
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ALLEGRO, "al_destroy_display");
+  }
+
+  if (pd->al_ctx.timer)
+  {
+    al_destroy_timer(pd->al_ctx.timer);
+    pd->al_ctx.timer = 0;
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ALLEGRO, "al_destroy_timer");
+  }
+
+  if (pd->al_ctx.event_queue)
+  {
+    al_destroy_event_queue(pd->al_ctx.event_queue);
+    pd->al_ctx.event_queue = 0;
+    EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ALLEGRO, "al_destroy_event_queue");
+  }
+
+  ezal_private_log_stop();
+
+  memset(&pd->al_ctx, 0, sizeof(struct EZALAllegroContext));
+  memset(&pd->rt_ctx, 0, sizeof(struct EZALRuntimeContext));
+  memset(pd, 0, sizeof(struct EZALPrivateData));
+
+  return true;
+}
+
+// main loop
+
+// with EZAL_STATIC_LOOP the loop calls the private functions for that
+// mode directly instead of going through the pd function pointers
+#if defined(EZAL_STATIC_LOOP)
+#define EZAL_LOOP_UPDATE(pd) ezal_private_update(pd)
+#if EZAL_STATIC_LOOP == EZAL_LOOP_SCALED
+#define EZAL_LOOP_RENDER(pd) ezal_private_render_scaled(pd)
+#define EZAL_LOOP_PRESENT(pd) ezal_private_present_scaled(pd)
+#elif EZAL_STATIC_LOOP == EZAL_LOOP_HEADLESS
+#define EZAL_LOOP_RENDER(pd) ezal_private_render_scaled(pd)
+#define EZAL_LOOP_PRESENT(pd) ezal_private_present_headless(pd)
+#elif EZAL_STATIC_LOOP == EZAL_LOOP_DEFAULT
+#define EZAL_LOOP_RENDER(pd) ezal_private_render_default(pd)
+#define EZAL_LOOP_PRESENT(pd) ezal_private_present_default(pd)
+#else
+#error "EZAL_STATIC_LOOP must be EZAL_LOOP_DEFAULT, EZAL_LOOP_SCALED or EZAL_LOOP_HEADLESS"
+#endif
+#else
+#define EZAL_LOOP_UPDATE(pd) (pd)->update(pd)
+#define EZAL_LOOP_RENDER(pd) (pd)->render(pd)
+#define EZAL_LOOP_PRESENT(pd) (pd)->present(pd)
+#endif
+
+bool ezal_private_run(struct EZALPrivateData* pd)
+{
+  pd->rt_ctx.is_running = true;
+  pd->rt_ctx.should_redraw = false;
+  pd->rt_ctx.create(&pd->rt_ctx);
+
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_RUNTIME, "starting main loop");
+  ezal_private_promote_bitmaps(pd, "main loop start");
+  ezal_private_resize(pd);
+  al_start_timer(pd->al_ctx.timer);
+  while (pd->rt_ctx.is_running)
+  {
+    EZAL_LOOP_UPDATE(pd);
+    if (pd->rt_ctx.should_redraw && al_is_event_queue_empty(pd->al_ctx.event_queue))
+    {
+      pd->rt_ctx.should_redraw = false;
+      if (ezal_private_should_render(pd))
+      {
+        EZAL_LOOP_RENDER(pd);
+        pd->rt_ctx.render(&pd->rt_ctx);
+        EZAL_LOOP_PRESENT(pd);
+        ezal_private_bitmaps_end_frame(pd);
+        pd->rt_ctx.post_render(&pd->rt_ctx);
+      }
+    }
+  }
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_RUNTIME, "main loop finished");
+
+  pd->rt_ctx.destroy(&pd->rt_ctx);
+
+  return true;
+}
+
+void ezal_private_dump_configuration(struct EZALPrivateData* pd)
+{
+  if (!EZAL_LOG_ENABLED(EZAL_LOG_LEVEL_INFO, EZAL_LOG_CATEGORY_CORE))
+  {
+    return;
+  }
+
+  #define EZALYESNO(x) (x?"YES":"NO")
+  #define EZALCFG(...) ezal_log_write(EZAL_LOG_LEVEL_INFO, EZAL_LOG_CATEGORY_CORE, __VA_ARGS__)
+  EZALCFG("configuration:");
+  EZALCFG("  width = %d", pd->cfg.width);
+  EZALCFG("  height = %d", pd->cfg.height);
+  EZALCFG("  logical width = %d", pd->cfg.logical_width);
+  EZALCFG("  logical height = %d", pd->cfg.logical_height);
+  EZALCFG("  audio samples = %d", pd->cfg.audio_samples);
+  EZALCFG("  frame rate = %d", pd->cfg.frame_rate);
+  EZALCFG("  render rate = %d", pd->cfg.render_rate);
+  EZALCFG("  background policy = %d", pd->cfg.background_policy);
+  EZALCFG("  background frame rate = %d", pd->cfg.background_frame_rate);
+  EZALCFG("  fullscreen = %s", EZALYESNO(pd->cfg.fullscreen));
+  EZALCFG("  auto scaling = %s", EZALYESNO(pd->cfg.auto_scale));
+  EZALCFG("  stretch scaling = %s", EZALYESNO(pd->cfg.stretch_scale));
+  EZALCFG("  audio enabled = %s", EZALYESNO(pd->cfg.enable_audio));
+  EZALCFG("  mouse enabled = %s", EZALYESNO(pd->cfg.enable_mouse));
+  EZALCFG("  keyboard enabled = %s", EZALYESNO(pd->cfg.enable_keyboard));
+  EZALCFG("  debug = %s", EZALYESNO(pd->cfg.debug));
+  EZALCFG("  headless = %s", EZALYESNO(pd->cfg.headless));
+  EZALCFG("  log level = %d", pd->cfg.log_level);
+  EZALCFG("  log categories = 0x%04x", pd->cfg.log_categories);
+  EZALCFG("");
+  #undef EZALCFG
+  #undef EZALYESNO
+}
+
+int ezal_private_adapter_start(struct EZALRuntimeAdapter* rta)
+{
+  if (!rta)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_CORE, "Fatal Error: rta is not a valid EZALRuntimeAdapter pointer");
+    exit(EXIT_FAILURE);
+  }
+
+  struct EZALPrivateData* pd = (struct EZALPrivateData*)rta->rt_ctx->_ezal_reserved;
+
+  if (!ezal_private_run(pd))
+  {
+    exit(EXIT_FAILURE);
+  }
+
+  if (!ezal_private_quit(pd))
+  {
+    exit(EXIT_FAILURE);
+  }
+
+  free(pd);
+  free(rta);
+
+  return EXIT_SUCCESS;
+}
+
+// public api functions
+
+void ezal_use_config_defaults(struct EZALConfig* cfg)
+{
+  if (!cfg)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_CORE, "Error: ezal_use_config_defaults requires a valid EZALConfig pointer");
+    return;
+  }
+
+  cfg->width = 800;
+  cfg->height = 600;
+  cfg->logical_width = 800;
+  cfg->logical_height = 600;
+  cfg->fullscreen = false;
+  cfg->auto_scale = false;
+  cfg->stretch_scale = false;
+  cfg->audio_samples = 1;
+  cfg->enable_audio = true;
+  cfg->enable_mouse = true;
+  cfg->enable_keyboard = true;
+  cfg->debug = false;
+  cfg->headless = false;
+  cfg->frame_rate = 30;
+  cfg->render_rate = 0;
+  cfg->background_policy = EZAL_BACKGROUND_CONTINUE;
+  cfg->background_frame_rate = 5;
+  cfg->log_level = EZAL_LOG_LEVEL_WARN;
+  cfg->log_categories = EZAL_LOG_CATEGORY_ALL;
+}
+
+/**
+ * @brief ezal program entry point
+ * The main game loop and calls to the user functions are all
+ * handled behind the scenes with this one function call.
+ * @param title name of your game
+ * @param create user function for creation (before main loop)
+ * @param destroy user function for destruction (after main loop)
+ * @param update user function for update (in main loop every frame)
+ * @param render user function for render (in main loop every frame)
+ * @param cfg optional configuration use zero for default
+ * @return int returns 0 on success and not zero on failure
+ */
+int ezal_start(
+  const char* title,
+  EZALFPTR create,
+  EZALFPTR destroy,
+  EZALFPTR update,
+  EZALFPTR render,
+  struct EZALConfig* cfg
+)
+{
+  struct EZALPrivateData pd_obj;
+  struct EZALPrivateData* pd = &pd_obj;
+  memset(pd, 0, sizeof(struct EZALPrivateData));
+
+  ezal_private_copy_config(cfg, &pd->cfg);
+  ezal_private_log_configure(&pd->cfg);
+  ezal_private_dump_configuration(pd);
+
+  if (!ezal_private_init(pd, create, destroy, update, render))
+  {
+    exit(EXIT_FAILURE);
+  }
+
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_RUNTIME, "starting %s", title);
+
+  if (pd->al_ctx.display)
+  {
+    al_set_window_title(pd->al_ctx.display, title);
+  }
+
+  if (!ezal_private_run(pd))
+  {
+    exit(EXIT_FAILURE);
+  }
+
+  if (!ezal_private_quit(pd))
+  {
+    exit(EXIT_FAILURE);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+struct EZALRuntimeAdapter* ezal_init(
+  const char* title,
+  EZALFPTR create,
+  EZALFPTR destroy,
+  EZALFPTR update,
+  EZALFPTR render,
+  struct EZALConfig* cfg)
+{
+  struct EZALPrivateData* pd = (struct EZALPrivateData*)calloc(1, sizeof(struct EZALPrivateData));
+
+  ezal_private_copy_config(cfg, &pd->cfg);
+  ezal_private_log_configure(&pd->cfg);
+  ezal_private_dump_configuration(pd);
+
+  if (!ezal_private_init(pd, create, destroy, update, render))
+  {
+    exit(EXIT_FAILURE);
+  }
+
+  if (pd->al_ctx.display)
+  {
+    al_set_window_title(pd->al_ctx.display, title);
+  }
+
+  struct EZALRuntimeAdapter* rta = (struct EZALRuntimeAdapter*)malloc(sizeof(struct EZALRuntimeAdapter));
+
+  rta->rt_ctx = &pd->rt_ctx;
+  rta->rt_ctx->_ezal_reserved = pd;
+  rta->start = &ezal_private_adapter_start;
+
+  return rta;
+}
+
+void ezal_stop(struct EZALRuntimeContext* ctx)
+{
+  if (!ctx)
+  {
+    return;
+  }
+  ctx->is_running = false;
+  ctx->should_redraw = false;
+}
+
+void ezal_use_capture_defaults(struct EZALCaptureConfig* cfg)
+{
+  if (!cfg)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_CORE, "Error: ezal_use_capture_defaults requires a valid EZALCaptureConfig pointer");
+    return;
+  }
+
+  cfg->path = "capture";
+  cfg->format = EZAL_CAPTURE_FORMAT_PNG;
+  cfg->buffer_count = 8;
+  cfg->worker_count = 2;
+  cfg->frame_interval = 1;
+}
+
+/**
+ * @brief starts recording every presented frame
+ * Frames are copied into a pool of buffers on the main thread and
+ * written by worker threads. When no buffer is free the frame is
+ * dropped and counted instead of stalling the main loop.
+ * @param ctx the runtime context
+ * @param cfg optional capture configuration use zero for default
+ * @return bool returns true when the capture was started
+ */
+bool ezal_capture_start(struct EZALRuntimeContext* ctx, struct EZALCaptureConfig* cfg)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd)
+  {
+    return false;
+  }
+  return ezal_private_capture_start(pd, cfg);
+}
+
+void ezal_capture_stop(struct EZALRuntimeContext* ctx)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd)
+  {
+    return;
+  }
+  ezal_private_capture_stop(pd);
+}
+
+bool ezal_capture_is_active(struct EZALRuntimeContext* ctx)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  return pd && pd->capture.active;
+}
+
+void ezal_capture_get_stats(struct EZALRuntimeContext* ctx, struct EZALCaptureStats* stats)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd || !stats)
+  {
+    return;
+  }
+
+  struct EZALCaptureContext* cap = &pd->capture;
+  if (!cap->active)
+  {
+    memcpy(stats, &cap->stats, sizeof(struct EZALCaptureStats));
+    return;
+  }
+
+  al_lock_mutex(cap->mutex);
+  memcpy(stats, &cap->stats, sizeof(struct EZALCaptureStats));
+  al_unlock_mutex(cap->mutex);
+}
+
+/**
+ * @brief changes the frame rate (simulation ticks per second) at runtime
+ * @param ctx the runtime context
+ * @param frame_rate ticks per second, must be greater than 0
+ * @return bool returns true when the frame rate was changed
+ */
+bool ezal_set_frame_rate(struct EZALRuntimeContext* ctx, int frame_rate)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd)
+  {
+    return false;
+  }
+  return ezal_private_set_frame_rate(pd, frame_rate);
+}
+
+/**
+ * @brief limits how many frames per second are rendered
+ * The update function keeps being called at the frame rate.
+ * @param ctx the runtime context
+ * @param render_rate frames per second, 0 renders every tick
+ * @return bool returns true when the render rate was changed
+ */
+bool ezal_set_render_rate(struct EZALRuntimeContext* ctx, int render_rate)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd || render_rate < 0)
+  {
+    return false;
+  }
+  pd->cfg.render_rate = render_rate;
+  ezal_private_apply_throttle(pd);
+  return true;
+}
+
+void ezal_set_background_policy(struct EZALRuntimeContext* ctx, int policy)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd)
+  {
+    return;
+  }
+  pd->cfg.background_policy = policy;
+  ezal_private_apply_throttle(pd);
+}
+
+bool ezal_is_in_background(struct EZALRuntimeContext* ctx)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  return pd && pd->in_background;
+}
+
+/**
+ * @brief loads a bitmap and adds it to the bitmap registry
+ * Bitmaps loaded before there is a display on the calling thread (for
+ * example on a worker thread) are memory bitmaps, the runtime promotes
+ * them to video bitmaps when the main loop starts and whenever the
+ * display is switched back in.
+ * @param ctx the runtime context
+ * @param filename image file to load
+ * @return ALLEGRO_BITMAP* the bitmap or zero on failure
+ */
+ALLEGRO_BITMAP* ezal_load_bitmap(struct EZALRuntimeContext* ctx, const char* filename)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd || !filename)
+  {
+    return 0;
+  }
+
+  ALLEGRO_BITMAP* bitmap = al_load_bitmap(filename);
+  if (!bitmap)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_BITMAP, "al_load_bitmap(%s) failed.", filename);
+    return 0;
+  }
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_BITMAP, "al_load_bitmap(%s) %s", filename,
+    ezal_private_bitmap_is_memory(bitmap) ? "memory" : "video");
+
+  if (!ezal_private_bitmaps_add(&pd->bitmaps, bitmap))
+  {
+    al_destroy_bitmap(bitmap);
+    return 0;
+  }
+
+  return bitmap;
+}
+
+ALLEGRO_BITMAP* ezal_create_bitmap(struct EZALRuntimeContext* ctx, int width, int height)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd)
+  {
+    return 0;
+  }
+
+  ALLEGRO_BITMAP* bitmap = al_create_bitmap(width, height);
+  if (!bitmap)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_BITMAP, "al_create_bitmap(%d,%d) failed.", width, height);
+    return 0;
+  }
+
+  if (!ezal_private_bitmaps_add(&pd->bitmaps, bitmap))
+  {
+    al_destroy_bitmap(bitmap);
+    return 0;
+  }
+
+  return bitmap;
+}
+
+/**
+ * @brief adds a bitmap you created yourself to the bitmap registry
+ * You still own the bitmap, unregister it (or use ezal_destroy_bitmap)
+ * before you destroy it yourself.
+ */
+bool ezal_register_bitmap(struct EZALRuntimeContext* ctx, ALLEGRO_BITMAP* bitmap)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd || !bitmap)
+  {
+    return false;
+  }
+  return ezal_private_bitmaps_add(&pd->bitmaps, bitmap);
+}
+
+bool ezal_unregister_bitmap(struct EZALRuntimeContext* ctx, ALLEGRO_BITMAP* bitmap)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd || !bitmap)
+  {
+    return false;
+  }
+  return ezal_private_bitmaps_remove(&pd->bitmaps, bitmap);
+}
+
+void ezal_destroy_bitmap(struct EZALRuntimeContext* ctx, ALLEGRO_BITMAP* bitmap)
+{
+  if (!bitmap)
+  {
+    return;
+  }
+  ezal_unregister_bitmap(ctx, bitmap);
+  al_destroy_bitmap(bitmap);
+}
+
+int ezal_promote_bitmaps(struct EZALRuntimeContext* ctx)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd)
+  {
+    return 0;
+  }
+  return ezal_private_promote_bitmaps(pd, "ezal_promote_bitmaps");
+}
+
+void ezal_get_bitmap_stats(struct EZALRuntimeContext* ctx, struct EZALBitmapStats* stats)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd || !stats)
+  {
+    return;
+  }
+  ezal_private_bitmaps_stats(&pd->bitmaps, stats);
+}
+
+void ezal_draw_bitmap(
+  struct EZALRuntimeContext* ctx,
+  ALLEGRO_BITMAP* bitmap,
+  float dx,
+  float dy,
+  int flags)
+{
+  ezal_private_note_bitmap_draw(ezal_private_get_pd(ctx), bitmap);
+  if (!ezal_private_soft_blit(
+    bitmap,
+    0.0f,
+    0.0f,
+    (float)al_get_bitmap_width(bitmap),
+    (float)al_get_bitmap_height(bitmap),
+    dx,
+    dy,
+    0,
+    flags))
+  {
+    al_draw_bitmap(bitmap, dx, dy, flags);
   }
 }
 
-void ezal_private_update(struct EZALPrivateData* pd)
+void ezal_draw_tinted_bitmap(
+  struct EZALRuntimeContext* ctx,
+  ALLEGRO_BITMAP* bitmap,
+  ALLEGRO_COLOR tint,
+  float dx,
+  float dy,
+  int flags)
 {
-  al_wait_for_event(pd->al_ctx.event_queue, &pd->al_ctx.event);
-
-  switch (pd->al_ctx.event.type)
+  ezal_private_note_bitmap_draw(ezal_private_get_pd(ctx), bitmap);
+  if (!ezal_private_soft_blit(
+    bitmap,
+    0.0f,
+    0.0f,
+    (float)al_get_bitmap_width(bitmap),
+    (float)al_get_bitmap_height(bitmap),
+    dx,
+    dy,
+    &tint,
+    flags))
   {
-    case ALLEGRO_EVENT_TIMER: {
-      pd->rt_ctx.should_redraw = true;
-
-      pd->rt_ctx.update(&pd->rt_ctx);
-
-      for (int i = 0; i < ALLEGRO_KEY_MAX; i++) {
-        pd->input.key[i] &= 1;
-      }
-      pd->input.mouse_state &= 1;
-    } break;
-    case ALLEGRO_EVENT_KEY_DOWN: {
-      pd->input.key[pd->al_ctx.event.keyboard.keycode] = 1 | 2;
-    } break;
-    case ALLEGRO_EVENT_KEY_UP: {
-      pd->input.key[pd->al_ctx.event.keyboard.keycode] &= 2;
-    } break;
-    case ALLEGRO_EVENT_MOUSE_AXES: {
-      pd->input.mouse_x = pd->al_ctx.event.mouse.x;
-      pd->input.mouse_y = pd->al_ctx.event.mouse.y;
-    } break;
-    case ALLEGRO_EVENT_MOUSE_BUTTON_DOWN: {
-      pd->input.mouse_state = 1 | 2;
-      pd->input.mouse_button = pd->al_ctx.event.mouse.button;
-    } break;
-    case ALLEGRO_EVENT_MOUSE_BUTTON_UP: {
-      pd->input.mouse_state &= 2;
-      pd->input.mouse_button = pd->al_ctx.event.mouse.button;
-    } break;
-    case ALLEGRO_EVENT_DISPLAY_CLOSE: {
-      pd->halt(pd);
-    } break;
-    case ALLEGRO_EVENT_DISPLAY_RESIZE: {
-      if (al_acknowledge_resize(pd->al_ctx.event.display.source))
-      {
-        pd->resize(pd);
-      }
-    } break;
-    case ALLEGRO_EVENT_DISPLAY_SWITCH_IN: {
-      pd->resize(pd);
-    } break;
-    default: break;
+    al_draw_tinted_bitmap(bitmap, tint, dx, dy, flags);
   }
 }
 
-void ezal_private_render_default(struct EZALPrivateData* pd)
+void ezal_draw_bitmap_region(
+  struct EZALRuntimeContext* ctx,
+  ALLEGRO_BITMAP* bitmap,
+  float sx,
+  float sy,
+  float sw,
+  float sh,
+  float dx,
+  float dy,
+  int flags)
 {
-  al_clear_to_color(pd->al_ctx.screen_color);
+  ezal_private_note_bitmap_draw(ezal_private_get_pd(ctx), bitmap);
+  if (!ezal_private_soft_blit(bitmap, sx, sy, sw, sh, dx, dy, 0, flags))
+  {
+    al_draw_bitmap_region(bitmap, sx, sy, sw, sh, dx, dy, flags);
+  }
 }
 
-void ezal_private_present_default(struct EZALPrivateData* pd)
+void ezal_draw_scaled_bitmap(
+  struct EZALRuntimeContext* ctx,
+  ALLEGRO_BITMAP* bitmap,
+  float sx,
+  float sy,
+  float sw,
+  float sh,
+  float dx,
+  float dy,
+  float dw,
+  float dh,
+  int flags)
 {
-  al_flip_display();
+  ezal_private_note_bitmap_draw(ezal_private_get_pd(ctx), bitmap);
+  if (!ezal_private_soft_scaled_blit(bitmap, sx, sy, sw, sh, dx, dy, dw, dh, flags))
+  {
+    al_draw_scaled_bitmap(bitmap, sx, sy, sw, sh, dx, dy, dw, dh, flags);
+  }
 }
 
-void ezal_private_render_scaled(struct EZALPrivateData* pd)
+void ezal_clear_to_color(struct EZALRuntimeContext* ctx, ALLEGRO_COLOR color)
 {
-  al_set_target_bitmap(pd->al_ctx.buffer);
-  al_clear_to_color(pd->al_ctx.screen_color);
+  if (!ezal_private_soft_clear(color))
+  {
+    al_clear_to_color(color);
+  }
 }
 
-void ezal_private_present_scaled(struct EZALPrivateData* pd)
+void ezal_draw_filled_rectangle(
+  struct EZALRuntimeContext* ctx,
+  float x1,
+  float y1,
+  float x2,
+  float y2,
+  ALLEGRO_COLOR color)
 {
-  al_set_target_backbuffer(pd->al_ctx.display);
-  // rgb(51 102 153)
-  al_clear_to_color(pd->al_ctx.border_color);
-  // al_clear_to_color(al_map_rgb(0, 0, 0));
-  al_draw_scaled_bitmap(
-    pd->al_ctx.buffer,
-    0,
-    0,
-    pd->cfg.logical_width,
-    pd->cfg.logical_height,
-    pd->x,
-    pd->y,
-    pd->w,
-    pd->h,
-    0);
-  al_flip_display();
+  if (!ezal_private_soft_filled_rectangle(x1, y1, x2, y2, color))
+  {
+    al_draw_filled_rectangle(x1, y1, x2, y2, color);
+  }
 }
 
-// private api functions
-
-// configuration
-void ezal_private_copy_config(struct EZALConfig* src, struct EZALConfig* dst)
+uint64_t ezal_get_tick(struct EZALRuntimeContext* ctx)
 {
-  ezal_use_config_defaults(dst);
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  return pd ? pd->scheduler.tick : 0;
+}
 
-  if (src == 0)
+/**
+ * @brief calls fn once after delay ticks
+ * Due timers are fired in a batch at the start of every tick, before
+ * the user update function. A delay of 0 fires on the next tick.
+ * @param ctx the runtime context
+ * @param delay number of ticks to wait
+ * @param fn user function to call
+ * @param data user data passed to fn
+ * @return unsigned int timer handle or 0 on failure
+ */
+unsigned int ezal_timer_after(
+  struct EZALRuntimeContext* ctx,
+  unsigned int delay,
+  EZALTIMERFPTR fn,
+  void* data)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd)
   {
-    return;
+    return 0;
   }
-
-  memcpy(dst, src, sizeof(struct EZALConfig));
+  return ezal_private_timer_schedule(&pd->scheduler, delay, 0, fn, data);
 }
 
-// initialization
+/**
+ * @brief calls fn after delay ticks and then every interval ticks
+ * @param ctx the runtime context
+ * @param delay number of ticks before the first call
+ * @param interval number of ticks between calls (must not be 0)
+ * @param fn user function to call
+ * @param data user data passed to fn
+ * @return unsigned int timer handle or 0 on failure
+ */
+unsigned int ezal_timer_every(
+  struct EZALRuntimeContext* ctx,
+  unsigned int delay,
+  unsigned int interval,
+  EZALTIMERFPTR fn,
+  void* data)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd || !interval)
+  {
+    return 0;
+  }
+  return ezal_private_timer_schedule(&pd->scheduler, delay, interval, fn, data);
+}
 
-bool ezal_private_init_allegro(struct EZALPrivateData* pd)
+bool ezal_timer_cancel(struct EZALRuntimeContext* ctx, unsigned int timer)
 {
-  if (!al_init())
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd)
   {
-    fprintf(stderr, "al_init failed.\n");
     return false;
   }
-  if (pd->cfg.debug) { fprintf(stdout, "al_init\n"); }
 
-  if (pd->cfg.enable_keyboard)
+  struct EZALScheduler* sch = &pd->scheduler;
+  int index = ezal_private_timer_lookup(sch, timer);
+  if (index == -1)
   {
-    memset(pd->input.key, 0, sizeof(pd->input.key));
-    if (!al_install_keyboard())
-    {
-      fprintf(stderr, "al_install_keyboard failed.\n");
-      return false;
-    }
-    if (pd->cfg.debug) { fprintf(stdout, "al_install_keyboard\n"); }
+    return false;
   }
 
-  if (pd->cfg.enable_mouse)
+  ezal_private_timer_unlink(sch, index);
+  ezal_private_timer_free(sch, index);
+
+  return true;
+}
+
+bool ezal_timer_is_pending(struct EZALRuntimeContext* ctx, unsigned int timer)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  return pd && ezal_private_timer_lookup(&pd->scheduler, timer) != -1;
+}
+
+int ezal_timer_get_pending_count(struct EZALRuntimeContext* ctx)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  return pd ? pd->scheduler.pending : 0;
+}
+
+struct EZALNavGrid* ezal_nav_create_grid(struct EZALRuntimeContext* ctx, int width, int height, bool diagonal)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd || width < 1 || height < 1 || width > EZAL_NAV_MAX_SIZE || height > EZAL_NAV_MAX_SIZE)
   {
-    if (!al_install_mouse())
-    {
-      fprintf(stderr, "al_install_mouse failed.\n");
-      return false;
-    }
-    if (pd->cfg.debug) { fprintf(stdout, "al_install_mouse\n"); }
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_NAV, "ezal_nav_create_grid(%d,%d) invalid size", width, height);
+    return 0;
   }
 
-  if (pd->cfg.enable_audio)
+  struct EZALNavGrid* grid = (struct EZALNavGrid*)calloc(1, sizeof(struct EZALNavGrid));
+  if (!grid)
   {
-    if (!al_install_audio())
-    {
-      fprintf(stderr, "al_install_audio failed.\n");
-      return false;
-    }
-    if (pd->cfg.debug) { fprintf(stdout, "al_install_audio\n"); }
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_NAV, "navigation grid allocation failed.");
+    return 0;
   }
 
-  double frame_rate = 1.0 / (double)pd->cfg.frame_rate;
+  grid->pd = pd;
+  grid->width = width;
+  grid->height = height;
+  grid->cells = width * height;
+  grid->diagonal = diagonal;
+  grid->region_columns = (width + EZAL_NAV_REGION_SIZE - 1) / EZAL_NAV_REGION_SIZE;
+  int regions = grid->region_columns * ((height + EZAL_NAV_REGION_SIZE - 1) / EZAL_NAV_REGION_SIZE);
+  grid->region_words = (regions + 63) / 64;
 
-  pd->al_ctx.timer = 0;
-  ALLEGRO_TIMER* timer = al_create_timer(frame_rate);
-  if (!timer)
+  grid->cost = (unsigned char*)malloc((size_t)grid->cells);
+  grid->dirty = (uint64_t*)calloc((size_t)grid->region_words, sizeof(uint64_t));
+  grid->cache.regions = (uint64_t*)calloc((size_t)EZAL_NAV_CACHE_SIZE * grid->region_words, sizeof(uint64_t));
+  grid->component = (int32_t*)malloc((size_t)grid->cells * sizeof(int32_t));
+  if (!grid->cost || !grid->dirty || !grid->cache.regions || !grid->component ||
+    !ezal_private_nav_search_alloc(grid, &grid->searches[0]))
   {
-    fprintf(stderr, "al_create_timer(%g) failed.\n", frame_rate);
-    return false;
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_NAV, "navigation grid allocation (%dx%d) failed.", width, height);
+    ezal_private_nav_free_grid(grid);
+    return 0;
   }
-  if (pd->cfg.debug) { fprintf(stdout, "al_create_timer(%g)\n", frame_rate); }
-  pd->al_ctx.timer = timer;
 
-  pd->al_ctx.event_queue = 0;
-  ALLEGRO_EVENT_QUEUE* event_queue = al_create_event_queue();
-  if (!event_queue)
+  memset(grid->cost, 1, (size_t)grid->cells);
+  grid->components_dirty = true;
+  for (int i = 0; i < EZAL_NAV_CACHE_SIZE; i++)
   {
-    fprintf(stderr, "al_create_event_queue failed.\n");
-    return false;
+    grid->cache.entries[i].start = -1;
   }
-  if (pd->cfg.debug) { fprintf(stdout, "al_create_event_queue\n"); }
-  pd->al_ctx.event_queue = event_queue;
 
-  al_set_new_display_flags(pd->cfg.fullscreen
-    ? ALLEGRO_FULLSCREEN_WINDOW
-    : ALLEGRO_RESIZABLE);
+  grid->next = pd->nav.grids;
+  pd->nav.grids = grid;
 
-  pd->al_ctx.display = 0;
-  ALLEGRO_DISPLAY* display = al_create_display(
-      pd->cfg.width,
-      pd->cfg.height);
-  if (!display)
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_NAV, "created %dx%d navigation grid (%d regions)", width, height, regions);
+  return grid;
+}
+
+void ezal_nav_destroy_grid(struct EZALRuntimeContext* ctx, struct EZALNavGrid* grid)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd || !grid)
   {
-    fprintf(stderr, "al_create_display(%d,%d) failed.\n",
-        pd->cfg.width,
-        pd->cfg.height);
-    return false;
+    return;
   }
-  if (pd->cfg.debug) { fprintf(stdout, "al_create_display(%d,%d)\n", pd->cfg.width, pd->cfg.height); }
-  pd->al_ctx.display = display;
-  pd->w = al_get_display_width(display);
-  pd->h = al_get_display_height(display);
 
-  pd->al_ctx.buffer = 0;
-  if (pd->cfg.auto_scale)
+  for (struct EZALNavGrid** link = &pd->nav.grids; *link; link = &(*link)->next)
   {
-    ALLEGRO_BITMAP* buffer = al_create_bitmap(
-      pd->cfg.logical_width,
-      pd->cfg.logical_height);
-    if (!buffer)
+    if (*link == grid)
     {
-      fprintf(stderr, "al_create_bitmap(%d,%d) failed.\n",
-          pd->cfg.logical_width,
-          pd->cfg.logical_height);
-      return false;
+      *link = grid->next;
+      ezal_private_nav_free_grid(grid);
+      return;
     }
-    if (pd->cfg.debug) { fprintf(stdout, "al_create_bitmap(%d,%d)\n", pd->cfg.logical_width, pd->cfg.logical_height); }
-    pd->al_ctx.buffer = buffer;
   }
+}
 
-  if (!al_init_font_addon())
+void ezal_nav_set_cost(struct EZALNavGrid* grid, int x, int y, int cost)
+{
+  if (!grid || x < 0 || y < 0 || x >= grid->width || y >= grid->height)
   {
-    fprintf(stderr, "al_init_font_addon failed.\n");
-    return false;
+    return;
   }
-  if (pd->cfg.debug) { fprintf(stdout, "al_init_font_addon\n"); }
 
-  if (!al_init_ttf_addon())
+  unsigned char value = (unsigned char)(cost < 0 ? 0 : cost > 255 ? 255 : cost);
+  int cell = y * grid->width + x;
+  unsigned char old = grid->cost[cell];
+  if (value == old)
   {
-    fprintf(stderr, "al_init_ttf_addon failed.\n");
-    return false;
+    return;
   }
-  if (pd->cfg.debug) { fprintf(stdout, "al_init_ttf_addon\n"); }
 
-  if (!al_init_image_addon())
+  grid->cost[cell] = value;
+  grid->version++;
+  if (!value || !old)
   {
-    fprintf(stderr, "al_init_image_addon failed.\n");
-    return false;
+    grid->components_dirty = true;
   }
-  if (pd->cfg.debug) { fprintf(stdout, "al_init_image_addon\n"); }
 
-  if (!al_init_primitives_addon())
+  if (value && (!old || value < old))
   {
-    fprintf(stderr, "al_init_primitives_addon failed.\n");
-    return false;
+    grid->flush = true;
+  }
+  else
+  {
+    int region = ezal_private_nav_region(grid, x, y);
+    grid->dirty[region >> 6] |= (uint64_t)1 << (region & 63);
+    grid->dirty_any = true;
   }
-  if (pd->cfg.debug) { fprintf(stdout, "al_init_primitives_addon\n"); }
+}
 
-  if (pd->cfg.enable_audio)
+void ezal_nav_fill_cost(struct EZALNavGrid* grid, int x, int y, int width, int height, int cost)
+{
+  if (!grid || width < 1 || height < 1)
   {
-    if (!al_init_acodec_addon())
-    {
-      fprintf(stderr, "al_init_acodec_addon failed.\n");
-      return false;
-    }
-    if (pd->cfg.debug) { fprintf(stdout, "al_init_acodec_addon\n"); }
+    return;
+  }
 
-    if (!al_reserve_samples(pd->cfg.audio_samples))
+  // clip the rectangle to the grid, in 64 bit so x + width can't overflow
+  int64_t x0 = x < 0 ? 0 : x;
+  int64_t y0 = y < 0 ? 0 : y;
+  int64_t x1 = (int64_t)x + width;
+  int64_t y1 = (int64_t)y + height;
+  if (x1 > grid->width) { x1 = grid->width; }
+  if (y1 > grid->height) { y1 = grid->height; }
+
+  for (int row = (int)y0; row < (int)y1; row++)
+  {
+    for (int column = (int)x0; column < (int)x1; column++)
     {
-      fprintf(stderr, "al_reserve_samples(%d) failed.\n",
-          pd->cfg.audio_samples);
-      return false;
+      ezal_nav_set_cost(grid, column, row, cost);
     }
-    if (pd->cfg.debug) { fprintf(stdout, "al_reserve_samples(%d)\n", pd->cfg.audio_samples); }
   }
+}
 
-  pd->al_ctx.font = 0;
-  ALLEGRO_FONT* font = al_create_builtin_font();
-  if (!font)
+int ezal_nav_get_cost(struct EZALNavGrid* grid, int x, int y)
+{
+  if (!grid || x < 0 || y < 0 || x >= grid->width || y >= grid->height)
   {
-    fprintf(stderr, "al_create_builtin_font failed.\n");
-    return false;
+    return EZAL_NAV_BLOCKED;
   }
-  if (pd->cfg.debug) { fprintf(stdout, "al_create_builtin_font\n"); }
-  pd->al_ctx.font = font;
+  return grid->cost[y * grid->width + x];
+}
 
-  pd->al_ctx.border_color = al_map_rgb(0, 0, 0);
-  pd->al_ctx.screen_color = al_map_rgb(51, 102, 153);
+int ezal_nav_find_path(
+  struct EZALNavGrid* grid,
+  int start_x,
+  int start_y,
+  int goal_x,
+  int goal_y,
+  struct EZALNavPoint* path,
+  int max_length)
+{
+  if (!grid)
+  {
+    return EZAL_NAV_NO_PATH;
+  }
 
-  if (pd->cfg.enable_keyboard)
+  struct EZALNavQuery query;
+  query.start_x = start_x;
+  query.start_y = start_y;
+  query.goal_x = goal_x;
+  query.goal_y = goal_y;
+  query.path = path;
+  query.max_length = max_length;
+  query.length = EZAL_NAV_NO_PATH;
+
+  ezal_private_nav_cache_sync(grid);
+  if (!ezal_private_nav_resolve(grid, &query))
   {
-    al_register_event_source(
-      pd->al_ctx.event_queue,
-      al_get_keyboard_event_source());
-    if (pd->cfg.debug) { fprintf(stdout, "al_register_event_source(keyboard)\n"); }
+    ezal_private_nav_solve(grid, &grid->searches[0], &query);
+    ezal_private_nav_finish(grid, &query);
   }
+  return query.length;
+}
 
-  if (pd->cfg.enable_mouse)
+int ezal_nav_find_paths(
+  struct EZALRuntimeContext* ctx,
+  struct EZALNavGrid* grid,
+  struct EZALNavQuery* queries,
+  int count)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd || !grid || count < 1)
   {
-    al_register_event_source(
-      pd->al_ctx.event_queue,
-      al_get_mouse_event_source());
-    if (pd->cfg.debug) { fprintf(stdout, "al_register_event_source(mouse)\n"); }
+    return 0;
   }
 
-  al_register_event_source(
-    pd->al_ctx.event_queue,
-    al_get_display_event_source(pd->al_ctx.display));
-  if (pd->cfg.debug) { fprintf(stdout, "al_register_event_source(display)\n"); }
+  struct EZALNavPool* pool = &pd->nav.pool;
+  if (count > pool->pending_capacity)
+  {
+    int* pending = (int*)realloc(pool->pending, (size_t)count * sizeof(int));
+    if (!pending)
+    {
+      EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_NAV, "path batch allocation (%d queries) failed.", count);
+      return 0;
+    }
+    pool->pending = pending;
+    pool->pending_capacity = count;
+  }
 
-  al_register_event_source(
-    pd->al_ctx.event_queue,
-    al_get_timer_event_source(pd->al_ctx.timer));
-  if (pd->cfg.debug) { fprintf(stdout, "al_register_event_source(timer)\n"); }
+  ezal_private_nav_cache_sync(grid);
 
-  return true;
-}
+  pool->pending_count = 0;
+  for (int i = 0; i < count; i++)
+  {
+    if (!ezal_private_nav_resolve(grid, &queries[i]))
+    {
+      pool->pending[pool->pending_count++] = i;
+    }
+  }
 
-void ezal_runtime_do_nothing(struct EZALRuntimeContext* ctx)
-{
+  if (pool->pending_count)
+  {
+    ezal_private_nav_run_batch(pool, grid, queries);
+
+    // the same start and goal may have been searched more than once in
+    // this batch, the cache keeps the last one
+    for (int i = 0; i < pool->pending_count; i++)
+    {
+      ezal_private_nav_finish(grid, &queries[pool->pending[i]]);
+    }
+  }
 
+  int found = 0;
+  for (int i = 0; i < count; i++)
+  {
+    if (queries[i].length != EZAL_NAV_NO_PATH)
+    {
+      found++;
+    }
+  }
+  return found;
 }
 
-bool ezal_private_init_runtime(
-  struct EZALPrivateData* pd,
-  EZALFPTR create,
-  EZALFPTR destroy,
-  EZALFPTR update,
-  EZALFPTR render
-)
+void ezal_nav_clear_cache(struct EZALNavGrid* grid)
 {
-  pd->rt_ctx.cfg = &pd->cfg;
-  pd->rt_ctx.al_ctx = &pd->al_ctx;
-  pd->rt_ctx.input = &pd->input;
-
-  pd->rt_ctx.create = &ezal_runtime_do_nothing;
-  pd->rt_ctx.destroy = &ezal_runtime_do_nothing;
-  pd->rt_ctx.update = &ezal_runtime_do_nothing;
-  pd->rt_ctx.render = &ezal_runtime_do_nothing;
-  pd->rt_ctx.post_render = &ezal_runtime_do_nothing;
+  if (!grid)
+  {
+    return;
+  }
+  ezal_private_nav_cache_clear(grid);
+}
 
-  if (create)
+void ezal_nav_get_stats(struct EZALNavGrid* grid, struct EZALNavStats* stats)
+{
+  if (!grid || !stats)
   {
-    pd->rt_ctx.create = create;
-    if (pd->cfg.debug) { fprintf(stdout, "using user create function\n"); }
+    return;
   }
 
-  if (destroy)
+  *stats = grid->stats;
+  stats->nodes_expanded = 0;
+  for (int i = 0; i < EZAL_NAV_MAX_WORKERS + 1; i++)
   {
-    pd->rt_ctx.destroy = destroy;
-    if (pd->cfg.debug) { fprintf(stdout, "using user destroy function\n"); }
+    stats->nodes_expanded += grid->searches[i].expanded;
   }
+}
 
-  if (update)
+struct EZALFlowField* ezal_nav_create_flow_field(struct EZALNavGrid* grid)
+{
+  if (!grid)
   {
-    pd->rt_ctx.update = update;
-    if (pd->cfg.debug) { fprintf(stdout, "using user update function\n"); }
+    return 0;
   }
 
-  if (render)
+  struct EZALFlowField* field = (struct EZALFlowField*)calloc(1, sizeof(struct EZALFlowField));
+  if (field)
   {
-    pd->rt_ctx.render = render;
-    if (pd->cfg.debug) { fprintf(stdout, "using user render function\n"); }
+    field->distance = (uint32_t*)malloc((size_t)grid->cells * sizeof(uint32_t));
+    field->direction = (unsigned char*)malloc((size_t)grid->cells);
+  }
+  if (!field || !field->distance || !field->direction)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_NAV, "flow field allocation (%dx%d) failed.", grid->width, grid->height);
+    if (field)
+    {
+      ezal_private_nav_free_field(field);
+    }
+    return 0;
   }
 
-  return true;
+  memset(field->distance, 0xFF, (size_t)grid->cells * sizeof(uint32_t));
+  memset(field->direction, 4, (size_t)grid->cells);
+  field->grid = grid;
+  field->goal = -1;
+  field->next = grid->fields;
+  grid->fields = field;
+  return field;
 }
 
-bool ezal_private_init_pd(struct EZALPrivateData* pd)
+void ezal_nav_destroy_flow_field(struct EZALFlowField* field)
 {
-  pd->resize = &ezal_private_resize;
-  pd->halt = &ezal_private_halt;
-  pd->update = &ezal_private_update;
-  pd->render = &ezal_private_render_default;
-  pd->present = &ezal_private_present_default;
+  if (!field)
+  {
+    return;
+  }
 
-  if (pd->cfg.auto_scale)
+  for (struct EZALFlowField** link = &field->grid->fields; *link; link = &(*link)->next)
   {
-    pd->render = &ezal_private_render_scaled;
-    pd->present = &ezal_private_present_scaled;
-    if (pd->cfg.debug) { fprintf(stdout, "auto scale enabled\n"); }
+    if (*link == field)
+    {
+      *link = field->next;
+      ezal_private_nav_free_field(field);
+      return;
+    }
+  }
+}
+
+bool ezal_nav_build_flow_field(struct EZALFlowField* field, int goal_x, int goal_y)
+{
+  if (!field)
+  {
+    return false;
+  }
+
+  struct EZALNavGrid* grid = field->grid;
+  if (goal_x < 0 || goal_y < 0 || goal_x >= grid->width || goal_y >= grid->height)
+  {
+    return false;
+  }
+
+  int goal = goal_y * grid->width + goal_x;
+  if (field->goal == goal && field->version == grid->version)
+  {
+    return true;
+  }
+
+  field->goal = goal;
+  field->version = grid->version;
+  if (!grid->cost[goal])
+  {
+    memset(field->distance, 0xFF, (size_t)grid->cells * sizeof(uint32_t));
+    memset(field->direction, 4, (size_t)grid->cells);
+    return false;
   }
 
+  ezal_private_nav_flood(grid, &grid->searches[0], field);
   return true;
 }
 
-bool ezal_private_init(
-  struct EZALPrivateData* pd,
-  EZALFPTR create,
-  EZALFPTR destroy,
-  EZALFPTR update,
-  EZALFPTR render)
+bool ezal_nav_flow_step(struct EZALFlowField* field, int x, int y, struct EZALNavPoint* next)
 {
-  // initialize allegro
-  if (!ezal_private_init_allegro(pd))
+  if (!field || !next)
   {
     return false;
   }
-  if (pd->cfg.debug) { fprintf(stdout, "allegro initialization complete\n"); }
 
-  // initialize runtime
-  if (!ezal_private_init_runtime(pd, create, destroy, update, render))
+  struct EZALNavGrid* grid = field->grid;
+  next->x = x;
+  next->y = y;
+  if (x < 0 || y < 0 || x >= grid->width || y >= grid->height)
   {
     return false;
   }
-  if (pd->cfg.debug) { fprintf(stdout, "runtime initialization complete\n"); }
 
-  // initialize pd private function pointers based on cfg
-  if (!ezal_private_init_pd(pd))
+  int direction = field->direction[y * grid->width + x];
+  if (direction == 4)
   {
     return false;
   }
 
+  next->x = x + direction % 3 - 1;
+  next->y = y + direction / 3 - 1;
   return true;
 }
 
-// shutdown
-bool ezal_private_quit(struct EZALPrivateData* pd)
+int ezal_nav_flow_distance(struct EZALFlowField* field, int x, int y)
 {
-  if (pd->al_ctx.font)
+  if (!field)
   {
-    al_destroy_font(pd->al_ctx.font);
-    pd->al_ctx.font = 0;
-    if (pd->cfg.debug) { fprintf(stdout, "al_destroy_font\n"); }
+    return EZAL_NAV_NO_PATH;
   }
 
-  if (pd->al_ctx.buffer)
+  struct EZALNavGrid* grid = field->grid;
+  if (x < 0 || y < 0 || x >= grid->width || y >= grid->height)
   {
-    al_destroy_bitmap(pd->al_ctx.buffer);
-    pd->al_ctx.buffer = 0;
-    if (pd->cfg.debug) { fprintf(stdout, "al_destroy_bitmap\n"); }
+    return EZAL_NAV_NO_PATH;
   }
 
-  if (pd->al_ctx.display)
+  uint32_t distance = field->distance[y * grid->width + x];
+  if (distance == UINT32_MAX)
   {
-    al_destroy_display(pd->al_ctx.display);
-    pd->al_ctx.display = 0;
-    if (pd->cfg.debug) { fprintf(stdout, "al_destroy_display\n"); }
+    return EZAL_NAV_NO_PATH;
   }
+  return distance > INT_MAX ? INT_MAX : (int)distance;
+}
 
-  if (pd->al_ctx.timer)
+/**
+ * @brief opens an archive written by tools/ezalpack
+ * The file is mapped into memory, nothing is read or decoded until an
+ * asset is loaded. Archives still open are closed when the runtime
+ * shuts down.
+ * @param ctx the runtime context
+ * @param filename path of the archive
+ * @return the archive, or 0 when it could not be opened
+ */
+struct EZALArchive* ezal_open_archive(struct EZALRuntimeContext* ctx, const char* filename)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd || !filename)
   {
-    al_destroy_timer(pd->al_ctx.timer);
-    pd->al_ctx.timer = 0;
-    if (pd->cfg.debug) { fprintf(stdout, "al_destroy_timer\n"); }
+    return 0;
   }
 
-  if (pd->al_ctx.event_queue)
+  struct EZALArchive* archive = (struct EZALArchive*)calloc(1, sizeof(struct EZALArchive));
+  if (!archive)
   {
-    al_destroy_event_queue(pd->al_ctx.event_queue);
-    pd->al_ctx.event_queue = 0;
-    if (pd->cfg.debug) { fprintf(stdout, "al_destroy_event_queue\n"); }
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ASSET, "archive allocation failed.");
+    return 0;
   }
 
-  memset(&pd->al_ctx, 0, sizeof(struct EZALAllegroContext));
-  memset(&pd->rt_ctx, 0, sizeof(struct EZALRuntimeContext));
-  memset(pd, 0, sizeof(struct EZALPrivateData));
+  if (!ezal_private_archive_map(archive, filename) ||
+    !ezal_private_archive_validate(archive, filename))
+  {
+    ezal_private_archive_unmap(archive);
+    free(archive);
+    return 0;
+  }
 
-  return true;
+  archive->next = pd->archives;
+  pd->archives = archive;
+
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ASSET, "ezal_open_archive(%s) %d assets, %zu bytes %s", filename,
+    archive->count,
+    archive->size,
+    archive->mapped ? "mapped" : "read");
+  return archive;
 }
 
-// main loop
-bool ezal_private_run(struct EZALPrivateData* pd)
+void ezal_close_archive(struct EZALRuntimeContext* ctx, struct EZALArchive* archive)
 {
-  pd->rt_ctx.is_running = true;
-  pd->rt_ctx.should_redraw = false;
-  pd->rt_ctx.create(&pd->rt_ctx);
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd || !archive)
+  {
+    return;
+  }
 
-  if (pd->cfg.debug) { fprintf(stdout, "starting main loop\n"); }
-  ezal_private_resize(pd);
-  al_start_timer(pd->al_ctx.timer);
-  while (pd->rt_ctx.is_running)
+  for (struct EZALArchive** link = &pd->archives; *link; link = &(*link)->next)
   {
-    pd->update(pd);
-    if (pd->rt_ctx.should_redraw && al_is_event_queue_empty(pd->al_ctx.event_queue))
+    if (*link == archive)
     {
-      pd->rt_ctx.should_redraw = false;
-      pd->render(pd);
-      pd->rt_ctx.render(&pd->rt_ctx);
-      pd->present(pd);
-      pd->rt_ctx.post_render(&pd->rt_ctx);
+      *link = archive->next;
+      ezal_private_archive_unmap(archive);
+      free(archive);
+      return;
     }
   }
-  if (pd->cfg.debug) { fprintf(stdout, "main loop finished\n"); }
+}
 
-  pd->rt_ctx.destroy(&pd->rt_ctx);
+int ezal_archive_get_count(struct EZALArchive* archive)
+{
+  return archive ? archive->count : 0;
+}
 
-  return true;
+const struct EZALPackEntry* ezal_archive_get_entry(struct EZALArchive* archive, int index)
+{
+  if (!archive || index < 0 || index >= archive->count)
+  {
+    return 0;
+  }
+  return &archive->entries[index];
 }
 
-void ezal_private_dump_configuration_to_stdout(struct EZALPrivateData* pd)
+// entries are sorted by name
+const struct EZALPackEntry* ezal_archive_find(struct EZALArchive* archive, const char* name)
 {
-  #define EZALYESNO(x) (x?"YES":"NO")
-  const char* fmt = "configuration:\n"
-    "  width = %d\n"
-    "  height = %d\n"
-    "  logical width = %d\n"
-    "  logical height = %d\n"
-    "  audio samples = %d\n"
-    "  frame rate = %d\n"
-    "  fullscreen = %s\n"
-    "  auto scaling = %s\n"
-    "  stretch scaling = %s\n"
-    "  audio enabled = %s\n"
-    "  mouse enabled = %s\n"
-    "  keyboard enabled = %s\n"
-    "  debug = %s\n\n";
-
-  fprintf(
-    stdout,
-    fmt,
-    pd->cfg.width,
-    pd->cfg.height,
-    pd->cfg.logical_width,
-    pd->cfg.logical_height,
-    pd->cfg.audio_samples,
-    pd->cfg.frame_rate,
-    EZALYESNO(pd->cfg.fullscreen),
-    EZALYESNO(pd->cfg.auto_scale),
-    EZALYESNO(pd->cfg.stretch_scale),
-    EZALYESNO(pd->cfg.enable_audio),
-    EZALYESNO(pd->cfg.enable_mouse),
-    EZALYESNO(pd->cfg.enable_keyboard),
-    EZALYESNO(pd->cfg.debug));
-  #undef EZALYESNO
+  if (!archive || !name)
+  {
+    return 0;
+  }
+
+  int lo = 0;
+  int hi = archive->count - 1;
+  while (lo <= hi)
+  {
+    int mid = lo + (hi - lo) / 2;
+    int order = strcmp(name, archive->entries[mid].name);
+    if (!order)
+    {
+      return &archive->entries[mid];
+    }
+    if (order < 0)
+    {
+      hi = mid - 1;
+    }
+    else
+    {
+      lo = mid + 1;
+    }
+  }
+  return 0;
 }
 
-int ezal_private_adapter_start(struct EZALRuntimeAdapter* rta)
+const void* ezal_archive_get_data(struct EZALArchive* archive, const char* name, size_t* size)
 {
-  if (!rta)
+  const struct EZALPackEntry* entry = ezal_archive_find(archive, name);
+  if (!entry)
   {
-    fprintf(stderr, "Fatal Error: rta is not a valid EZALRuntimeAdapter pointer\n");
-    exit(EXIT_FAILURE);
+    return 0;
+  }
+  if (size)
+  {
+    *size = (size_t)entry->size;
   }
+  return archive->base + entry->offset;
+}
 
-  struct EZALPrivateData* pd = (struct EZALPrivateData*)rta->rt_ctx->_ezal_reserved;
+/**
+ * @brief creates a bitmap from pixels stored in an archive
+ * The pixels are copied straight from the archive into the locked
+ * bitmap, in the pixel format they were packed in. The bitmap is added
+ * to the bitmap registry like the ones from ezal_load_bitmap.
+ * @param ctx the runtime context
+ * @param archive the archive to load from
+ * @param name name of the asset in the archive
+ * @return the bitmap, or 0 on failure
+ */
+ALLEGRO_BITMAP* ezal_archive_load_bitmap(
+  struct EZALRuntimeContext* ctx,
+  struct EZALArchive* archive,
+  const char* name)
+{
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd || !archive || !name)
+  {
+    return 0;
+  }
 
-  if (!ezal_private_run(pd))
+  const struct EZALPackEntry* entry = ezal_private_archive_find(archive, name, EZAL_PACK_TYPE_BITMAP);
+  if (!entry)
   {
-    exit(EXIT_FAILURE);
+    return 0;
   }
+  ezal_private_archive_prefetch(archive, entry);
 
-  if (!ezal_private_quit(pd))
+  int format = al_get_new_bitmap_format();
+  al_set_new_bitmap_format((int)entry->format);
+  ALLEGRO_BITMAP* bitmap = al_create_bitmap((int)entry->a, (int)entry->b);
+  al_set_new_bitmap_format(format);
+  if (!bitmap)
   {
-    exit(EXIT_FAILURE);
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ASSET, "al_create_bitmap(%u,%u) failed for %s", entry->a, entry->b, name);
+    return 0;
   }
 
-  free(pd);
-  free(rta);
+  ALLEGRO_LOCKED_REGION* region = al_lock_bitmap(bitmap, (int)entry->format, ALLEGRO_LOCK_WRITEONLY);
+  if (!region)
+  {
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ASSET, "al_lock_bitmap failed for %s", name);
+    al_destroy_bitmap(bitmap);
+    return 0;
+  }
 
-  return EXIT_SUCCESS;
-}
+  const unsigned char* pixels = archive->base + entry->offset;
+  size_t row_size = (size_t)entry->a * (size_t)region->pixel_size;
+  if (region->pitch == (int)entry->c)
+  {
+    memcpy(region->data, pixels, (size_t)entry->c * (entry->b - 1) + row_size);
+  }
+  else
+  {
+    for (uint32_t row = 0; row < entry->b; row++)
+    {
+      memcpy((unsigned char*)region->data + (ptrdiff_t)row * region->pitch, pixels + (size_t)row * entry->c, row_size);
+    }
+  }
+  al_unlock_bitmap(bitmap);
 
-// public api functions
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ASSET, "ezal_archive_load_bitmap(%s) %ux%u %s", name, entry->a, entry->b,
+    ezal_private_bitmap_is_memory(bitmap) ? "memory" : "video");
 
-void ezal_use_config_defaults(struct EZALConfig* cfg)
-{
-  if (!cfg)
+  if (!ezal_private_bitmaps_add(&pd->bitmaps, bitmap))
   {
-    fprintf(stderr, "Error: ezal_use_config_defaults requires a valid EZALConfig pointer\n");
-    return;
+    al_destroy_bitmap(bitmap);
+    return 0;
   }
 
-  cfg->width = 800;
-  cfg->height = 600;
-  cfg->logical_width = 800;
-  cfg->logical_height = 600;
-  cfg->fullscreen = false;
-  cfg->auto_scale = false;
-  cfg->stretch_scale = false;
-  cfg->audio_samples = 1;
-  cfg->enable_audio = true;
-  cfg->enable_mouse = true;
-  cfg->enable_keyboard = true;
-  cfg->debug = false;
-  cfg->frame_rate = 30;
+  return bitmap;
 }
 
 /**
- * @brief ezal program entry point
- * The main game loop and calls to the user functions are all
- * handled behind the scenes with this one function call.
- * @param title name of your game
- * @param create user function for creation (before main loop)
- * @param destroy user function for destruction (after main loop)
- * @param update user function for update (in main loop every frame)
- * @param render user function for render (in main loop every frame)
- * @param cfg optional configuration use zero for default
- * @return int returns 0 on success and not zero on failure
+ * @brief creates a sample that plays straight from an archive
+ * The sample data is not copied. The sample belongs to the archive and
+ * is destroyed (and stopped) when the archive is closed, don't destroy
+ * it yourself.
+ * @param ctx the runtime context
+ * @param archive the archive to load from
+ * @param name name of the asset in the archive
+ * @return the sample, or 0 on failure
  */
-int ezal_start(
-  const char* title,
-  EZALFPTR create,
-  EZALFPTR destroy,
-  EZALFPTR update,
-  EZALFPTR render,
-  struct EZALConfig* cfg
-)
+ALLEGRO_SAMPLE* ezal_archive_load_sample(
+  struct EZALRuntimeContext* ctx,
+  struct EZALArchive* archive,
+  const char* name)
 {
-  struct EZALPrivateData pd_obj;
-  struct EZALPrivateData* pd = &pd_obj;
-
-  ezal_private_copy_config(cfg, &pd->cfg);
-  ezal_private_dump_configuration_to_stdout(pd);
-
-  if (!ezal_private_init(pd, create, destroy, update, render))
+  struct EZALPrivateData* pd = ezal_private_get_pd(ctx);
+  if (!pd || !archive || !name)
   {
-    exit(EXIT_FAILURE);
+    return 0;
   }
 
-  if (pd->cfg.debug) { fprintf(stdout, "starting %s\n", title); }
-
-  al_set_window_title(pd->al_ctx.display, title);
+  const struct EZALPackEntry* entry = ezal_private_archive_find(archive, name, EZAL_PACK_TYPE_SAMPLE);
+  if (!entry)
+  {
+    return 0;
+  }
+  ezal_private_archive_prefetch(archive, entry);
 
-  if (!ezal_private_run(pd))
+  // the mapping is read only, allegro never writes to sample data it
+  // does not own
+  ALLEGRO_SAMPLE* sample = al_create_sample(
+    (void*)(archive->base + entry->offset),
+    entry->c,
+    entry->a,
+    (int)entry->format,
+    (int)entry->b,
+    false);
+  if (!sample)
   {
-    exit(EXIT_FAILURE);
+    EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ASSET, "al_create_sample failed for %s", name);
+    return 0;
   }
 
-  if (!ezal_private_quit(pd))
+  if (archive->sample_count == archive->sample_capacity)
   {
-    exit(EXIT_FAILURE);
+    int capacity = archive->sample_capacity ? archive->sample_capacity * 2 : 16;
+    ALLEGRO_SAMPLE** samples = (ALLEGRO_SAMPLE**)realloc(archive->samples, (size_t)capacity * sizeof(ALLEGRO_SAMPLE*));
+    if (!samples)
+    {
+      EZAL_LOG(EZAL_LOG_LEVEL_ERROR, EZAL_LOG_CATEGORY_ASSET, "archive sample list allocation (%d samples) failed.", capacity);
+      al_destroy_sample(sample);
+      return 0;
+    }
+    archive->samples = samples;
+    archive->sample_capacity = capacity;
   }
+  archive->samples[archive->sample_count++] = sample;
 
-  return EXIT_SUCCESS;
+  EZAL_LOG(EZAL_LOG_LEVEL_DEBUG, EZAL_LOG_CATEGORY_ASSET, "ezal_archive_load_sample(%s) %u frames at %u Hz", name, entry->c, entry->a);
+  return sample;
 }
 
-struct EZALRuntimeAdapter* ezal_init(
-  const char* title,
-  EZALFPTR create,
-  EZALFPTR destroy,
-  EZALFPTR update,
-  EZALFPTR render,
-  struct EZALConfig* cfg)
+void ezal_log_write(int level, unsigned int category, const char* fmt, ...)
 {
-  struct EZALPrivateData* pd = (struct EZALPrivateData*)malloc(sizeof(struct EZALPrivateData));
+  if (!EZAL_LOG_ENABLED(level, category))
+  {
+    return;
+  }
 
-  ezal_private_copy_config(cfg, &pd->cfg);
-  ezal_private_dump_configuration_to_stdout(pd);
+  va_list args;
 
-  if (!ezal_private_init(pd, create, destroy, update, render))
+  // the producer count lets ezal_private_log_stop wait for messages that
+  // are being written into the ring while it shuts down
+  atomic_fetch_add(&ezal_private_log.producers, 1);
+  if (!atomic_load(&ezal_private_log.running))
   {
-    exit(EXIT_FAILURE);
+    atomic_fetch_sub(&ezal_private_log.producers, 1);
+    char message[EZAL_LOG_MESSAGE_MAX];
+    va_start(args, fmt);
+    vsnprintf(message, sizeof(message), fmt, args);
+    va_end(args);
+    ezal_private_log_output(level, message);
+    return;
   }
 
-  al_set_window_title(pd->al_ctx.display, title);
+  // claim a slot, never wait on the writer thread, drop the message instead
+  size_t pos = atomic_load_explicit(&ezal_private_log.write_pos, memory_order_relaxed);
+  struct EZALLogSlot* slot = 0;
+  for (;;)
+  {
+    slot = &ezal_private_log.ring[pos & (EZAL_LOG_RING_SIZE - 1)];
+    size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)pos;
 
-  struct EZALRuntimeAdapter* rta = (struct EZALRuntimeAdapter*)malloc(sizeof(struct EZALRuntimeAdapter));
+    if (diff == 0)
+    {
+      if (atomic_compare_exchange_weak_explicit(
+        &ezal_private_log.write_pos,
+        &pos,
+        pos + 1,
+        memory_order_relaxed,
+        memory_order_relaxed))
+      {
+        break;
+      }
+    }
+    else if (diff < 0)
+    {
+      atomic_fetch_add_explicit(&ezal_private_log.dropped, 1, memory_order_relaxed);
+      atomic_fetch_sub(&ezal_private_log.producers, 1);
+      return;
+    }
+    else
+    {
+      pos = atomic_load_explicit(&ezal_private_log.write_pos, memory_order_relaxed);
+    }
+  }
 
-  rta->rt_ctx = &pd->rt_ctx;
-  rta->rt_ctx->_ezal_reserved = pd;
-  rta->start = &ezal_private_adapter_start;
+  slot->level = level;
+  slot->category = category;
+  va_start(args, fmt);
+  vsnprintf(slot->message, sizeof(slot->message), fmt, args);
+  va_end(args);
 
-  return rta;
+  atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+
+  // pairs with the fence in the writer, either it sees the slot or this
+  // sees it sleeping
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load_explicit(&ezal_private_log.sleeping, memory_order_relaxed))
+  {
+    al_lock_mutex(ezal_private_log.mutex);
+    al_signal_cond(ezal_private_log.cond);
+    al_unlock_mutex(ezal_private_log.mutex);
+  }
+  atomic_fetch_sub(&ezal_private_log.producers, 1);
 }
 
-void ezal_stop(struct EZALRuntimeContext* ctx)
+void ezal_log_set_level(int level)
 {
-  if (!ctx)
+  atomic_store_explicit(&ezal_log_active_level, level, memory_order_relaxed);
+}
+
+void ezal_log_set_categories(unsigned int categories)
+{
+  atomic_store_explicit(&ezal_log_active_categories, categories, memory_order_relaxed);
+}
+
+/**
+ * @brief blocks until every queued log message has been written
+ */
+void ezal_log_flush(void)
+{
+  if (!atomic_load(&ezal_private_log.running))
   {
+    fflush(stdout);
     return;
   }
-  ctx->is_running = false;
-  ctx->should_redraw = false;
+
+  size_t target = atomic_load(&ezal_private_log.write_pos);
+  while (atomic_load(&ezal_private_log.running) &&
+    atomic_load(&ezal_private_log.read_pos) < target)
+  {
+    al_rest(0.001);
+  }
+}
+
+unsigned int ezal_log_get_dropped_count(void)
+{
+  return atomic_load(&ezal_private_log.dropped);
 }
@@ -32,10 +32,62 @@ SOFTWARE.
 #include <allegro5/allegro_audio.h>
 #include <allegro5/allegro_acodec.h>
 
+#include <stdatomic.h>
+
 #ifndef EZAL_MAX_USER_DATA_PTRS
 #define EZAL_MAX_USER_DATA_PTRS 1
 #endif
 
+// log levels, a message is written when its level is <= the active level
+#define EZAL_LOG_LEVEL_NONE 0
+#define EZAL_LOG_LEVEL_ERROR 1
+#define EZAL_LOG_LEVEL_WARN 2
+#define EZAL_LOG_LEVEL_INFO 3
+#define EZAL_LOG_LEVEL_DEBUG 4
+#define EZAL_LOG_LEVEL_TRACE 5
+
+// log categories, combine with | to build a category mask
+#define EZAL_LOG_CATEGORY_CORE 0x0001
+#define EZAL_LOG_CATEGORY_ALLEGRO 0x0002
+#define EZAL_LOG_CATEGORY_RUNTIME 0x0004
+#define EZAL_LOG_CATEGORY_INPUT 0x0008
+#define EZAL_LOG_CATEGORY_RENDER 0x0010
+#define EZAL_LOG_CATEGORY_AUDIO 0x0020
+#define EZAL_LOG_CATEGORY_CAPTURE 0x0040
+#define EZAL_LOG_CATEGORY_SCHEDULER 0x0080
+#define EZAL_LOG_CATEGORY_BITMAP 0x0100
+#define EZAL_LOG_CATEGORY_NAV 0x0200
+#define EZAL_LOG_CATEGORY_ASSET 0x0400
+#define EZAL_LOG_CATEGORY_USER 0x8000
+#define EZAL_LOG_CATEGORY_ALL 0xFFFF
+
+// messages above this level are removed at compile time
+#ifndef EZAL_LOG_COMPILE_LEVEL
+#define EZAL_LOG_COMPILE_LEVEL EZAL_LOG_LEVEL_TRACE
+#endif
+
+// number of messages the log ring buffer can hold (must be a power of two)
+#ifndef EZAL_LOG_RING_SIZE
+#define EZAL_LOG_RING_SIZE 256
+#endif
+
+// longest message the log can hold, longer messages are truncated
+#ifndef EZAL_LOG_MESSAGE_MAX
+#define EZAL_LOG_MESSAGE_MAX 200
+#endif
+
+// main loop modes for building ezal.c with -DEZAL_STATIC_LOOP=<mode>
+#define EZAL_LOOP_DEFAULT 1
+#define EZAL_LOOP_SCALED 2
+#define EZAL_LOOP_HEADLESS 3
+
+// what the runtime does while the display is in the background
+#define EZAL_BACKGROUND_CONTINUE 0
+#define EZAL_BACKGROUND_THROTTLE 1
+#define EZAL_BACKGROUND_PAUSE_RENDER 2
+#define EZAL_BACKGROUND_PAUSE 3
+#define EZAL_BACKGROUND_SLOW_DOWN 4
+
 struct EZALAllegroContext {
   ALLEGRO_TIMER* timer;
   ALLEGRO_DISPLAY* display;
@@ -54,6 +106,9 @@ struct EZALConfig {
   int logical_height;
   int audio_samples;
   int frame_rate;
+  int render_rate;
+  int background_policy;
+  int background_frame_rate;
 
   bool fullscreen;
   bool auto_scale;
@@ -62,6 +117,10 @@ struct EZALConfig {
   bool enable_mouse;
   bool enable_keyboard;
   bool debug;
+  bool headless;
+
+  int log_level;
+  unsigned int log_categories;
 };
 
 struct EZALInputContext {
@@ -77,6 +136,140 @@ struct EZALInputContext {
   int relative_mouse_y;
 };
 
+// frame capture output formats
+#define EZAL_CAPTURE_FORMAT_PNG 0
+#define EZAL_CAPTURE_FORMAT_RAW 1
+
+#ifndef EZAL_CAPTURE_MAX_WORKERS
+#define EZAL_CAPTURE_MAX_WORKERS 8
+#endif
+
+#ifndef EZAL_CAPTURE_MAX_PATH
+#define EZAL_CAPTURE_MAX_PATH 256
+#endif
+
+struct EZALCaptureConfig {
+  const char* path;
+  int format;
+  int buffer_count;
+  int worker_count;
+  int frame_interval;
+};
+
+struct EZALCaptureStats {
+  int width;
+  int height;
+
+  unsigned int frames_presented;
+  unsigned int frames_captured;
+  unsigned int frames_written;
+  unsigned int frames_dropped;
+  unsigned int frames_failed;
+  unsigned int frames_pending;
+};
+
+struct EZALBitmapStats {
+  int bitmap_count;
+  int video_count;
+  int memory_count;
+  size_t video_bytes;
+  size_t memory_bytes;
+
+  unsigned int promoted;
+  unsigned int memory_draws;
+  unsigned int memory_draw_frames;
+};
+
+// grid navigation
+// cells cost 1 (cheapest) to 255 to enter, EZAL_NAV_BLOCKED cells can't be entered
+#define EZAL_NAV_BLOCKED 0
+#define EZAL_NAV_NO_PATH -1
+#define EZAL_NAV_MAX_SIZE 1024
+
+// cells per side of the square regions the path cache is invalidated by
+#ifndef EZAL_NAV_REGION_SIZE
+#define EZAL_NAV_REGION_SIZE 16
+#endif
+
+// paths cached per grid, must be a power of two and at least 4
+#ifndef EZAL_NAV_CACHE_SIZE
+#define EZAL_NAV_CACHE_SIZE 4096
+#endif
+
+// max worker threads for ezal_nav_find_paths, the calling thread works too
+#ifndef EZAL_NAV_MAX_WORKERS
+#define EZAL_NAV_MAX_WORKERS 8
+#endif
+
+struct EZALNavGrid;
+struct EZALFlowField;
+
+struct EZALNavPoint {
+  int x;
+  int y;
+};
+
+struct EZALNavQuery {
+  int start_x;
+  int start_y;
+  int goal_x;
+  int goal_y;
+  struct EZALNavPoint* path;
+  int max_length;
+  int length;
+};
+
+struct EZALNavStats {
+  unsigned int queries;
+  unsigned int cache_hits;
+  unsigned int searches;
+  unsigned int unreachable;
+  unsigned int invalidated;
+  unsigned long long nodes_expanded;
+};
+
+// packed asset archives, written by tools/ezalpack and opened with
+// ezal_open_archive
+// the file is a header, the asset data and then the table of contents,
+// one entry per asset sorted by name
+#define EZAL_PACK_MAGIC "EZALPAK"
+#define EZAL_PACK_VERSION 1
+#define EZAL_PACK_BYTE_ORDER 0x01020304u
+#define EZAL_PACK_NAME_MAX 64
+#define EZAL_PACK_ALIGN 64
+
+#define EZAL_PACK_TYPE_DATA 0
+#define EZAL_PACK_TYPE_BITMAP 1
+#define EZAL_PACK_TYPE_SAMPLE 2
+
+struct EZALPackHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t entry_count;
+  uint32_t reserved;
+  uint64_t toc_offset;
+  uint64_t size;
+};
+
+// bitmaps: format is the ALLEGRO_PIXEL_FORMAT of the pixels, a and b are
+// the width and height and c is the bytes per row
+// samples: format is the ALLEGRO_AUDIO_DEPTH, a is the frequency, b the
+// ALLEGRO_CHANNEL_CONF and c the number of sample frames
+struct EZALPackEntry {
+  char name[EZAL_PACK_NAME_MAX];
+  uint32_t type;
+  uint32_t format;
+  uint32_t a;
+  uint32_t b;
+  uint32_t c;
+  uint32_t reserved;
+  uint64_t offset;
+  uint64_t size;
+};
+
+struct EZALArchive;
+
 struct EZALRuntimeContext {
   struct EZALConfig* cfg;
   struct EZALAllegroContext* al_ctx;
@@ -96,6 +289,7 @@ struct EZALRuntimeContext {
 };
 
 typedef void (*EZALFPTR)(struct EZALRuntimeContext*);
+typedef void (*EZALTIMERFPTR)(struct EZALRuntimeContext*, void*);
 
 struct EZALRuntimeAdapter {
   struct EZALRuntimeContext* rt_ctx;
@@ -103,8 +297,27 @@ struct EZALRuntimeAdapter {
 };
 
 #define EZAL_FN(identifier) void identifier(struct EZALRuntimeContext* ctx)
+#define EZAL_TIMER_FN(identifier) void identifier(struct EZALRuntimeContext* ctx, void* data)
 #define EZAL_KEY(keycode) (ctx->input->key[keycode] != 0x0)
 
+extern atomic_int ezal_log_active_level;
+extern atomic_uint ezal_log_active_categories;
+
+// errors are always written, whatever the active level and categories
+#define EZAL_LOG_ENABLED(level, category) \
+  ((level) <= EZAL_LOG_COMPILE_LEVEL && \
+  ((level) <= EZAL_LOG_LEVEL_ERROR || \
+  ((level) <= atomic_load_explicit(&ezal_log_active_level, memory_order_relaxed) && \
+  ((category) & atomic_load_explicit(&ezal_log_active_categories, memory_order_relaxed)) != 0)))
+
+#define EZAL_LOG(level, category, ...) \
+  do { \
+    if (EZAL_LOG_ENABLED(level, category)) \
+    { \
+      ezal_log_write(level, category, __VA_ARGS__); \
+    } \
+  } while (0)
+
 extern void ezal_use_config_defaults(struct EZALConfig* cfg);
 
 extern int ezal_start(
@@ -126,5 +339,136 @@ extern struct EZALRuntimeAdapter* ezal_init(
 
 extern void ezal_stop(struct EZALRuntimeContext* ctx);
 
+extern void ezal_use_capture_defaults(struct EZALCaptureConfig* cfg);
+extern bool ezal_capture_start(struct EZALRuntimeContext* ctx, struct EZALCaptureConfig* cfg);
+extern void ezal_capture_stop(struct EZALRuntimeContext* ctx);
+extern bool ezal_capture_is_active(struct EZALRuntimeContext* ctx);
+extern void ezal_capture_get_stats(struct EZALRuntimeContext* ctx, struct EZALCaptureStats* stats);
+
+extern bool ezal_set_frame_rate(struct EZALRuntimeContext* ctx, int frame_rate);
+extern bool ezal_set_render_rate(struct EZALRuntimeContext* ctx, int render_rate);
+extern void ezal_set_background_policy(struct EZALRuntimeContext* ctx, int policy);
+extern bool ezal_is_in_background(struct EZALRuntimeContext* ctx);
+
+extern ALLEGRO_BITMAP* ezal_load_bitmap(struct EZALRuntimeContext* ctx, const char* filename);
+extern ALLEGRO_BITMAP* ezal_create_bitmap(struct EZALRuntimeContext* ctx, int width, int height);
+extern bool ezal_register_bitmap(struct EZALRuntimeContext* ctx, ALLEGRO_BITMAP* bitmap);
+extern bool ezal_unregister_bitmap(struct EZALRuntimeContext* ctx, ALLEGRO_BITMAP* bitmap);
+extern void ezal_destroy_bitmap(struct EZALRuntimeContext* ctx, ALLEGRO_BITMAP* bitmap);
+extern int ezal_promote_bitmaps(struct EZALRuntimeContext* ctx);
+extern void ezal_get_bitmap_stats(struct EZALRuntimeContext* ctx, struct EZALBitmapStats* stats);
+
+extern void ezal_draw_bitmap(
+  struct EZALRuntimeContext* ctx,
+  ALLEGRO_BITMAP* bitmap,
+  float dx,
+  float dy,
+  int flags);
+extern void ezal_draw_tinted_bitmap(
+  struct EZALRuntimeContext* ctx,
+  ALLEGRO_BITMAP* bitmap,
+  ALLEGRO_COLOR tint,
+  float dx,
+  float dy,
+  int flags);
+extern void ezal_draw_bitmap_region(
+  struct EZALRuntimeContext* ctx,
+  ALLEGRO_BITMAP* bitmap,
+  float sx,
+  float sy,
+  float sw,
+  float sh,
+  float dx,
+  float dy,
+  int flags);
+extern void ezal_draw_scaled_bitmap(
+  struct EZALRuntimeContext* ctx,
+  ALLEGRO_BITMAP* bitmap,
+  float sx,
+  float sy,
+  float sw,
+  float sh,
+  float dx,
+  float dy,
+  float dw,
+  float dh,
+  int flags);
+
+extern void ezal_clear_to_color(struct EZALRuntimeContext* ctx, ALLEGRO_COLOR color);
+extern void ezal_draw_filled_rectangle(
+  struct EZALRuntimeContext* ctx,
+  float x1,
+  float y1,
+  float x2,
+  float y2,
+  ALLEGRO_COLOR color);
+
+extern uint64_t ezal_get_tick(struct EZALRuntimeContext* ctx);
+extern unsigned int ezal_timer_after(
+  struct EZALRuntimeContext* ctx,
+  unsigned int delay,
+  EZALTIMERFPTR fn,
+  void* data);
+extern unsigned int ezal_timer_every(
+  struct EZALRuntimeContext* ctx,
+  unsigned int delay,
+  unsigned int interval,
+  EZALTIMERFPTR fn,
+  void* data);
+extern bool ezal_timer_cancel(struct EZALRuntimeContext* ctx, unsigned int timer);
+extern bool ezal_timer_is_pending(struct EZALRuntimeContext* ctx, unsigned int timer);
+extern int ezal_timer_get_pending_count(struct EZALRuntimeContext* ctx);
+
+extern struct EZALNavGrid* ezal_nav_create_grid(
+  struct EZALRuntimeContext* ctx,
+  int width,
+  int height,
+  bool diagonal);
+extern void ezal_nav_destroy_grid(struct EZALRuntimeContext* ctx, struct EZALNavGrid* grid);
+extern void ezal_nav_set_cost(struct EZALNavGrid* grid, int x, int y, int cost);
+extern void ezal_nav_fill_cost(struct EZALNavGrid* grid, int x, int y, int width, int height, int cost);
+extern int ezal_nav_get_cost(struct EZALNavGrid* grid, int x, int y);
+extern int ezal_nav_find_path(
+  struct EZALNavGrid* grid,
+  int start_x,
+  int start_y,
+  int goal_x,
+  int goal_y,
+  struct EZALNavPoint* path,
+  int max_length);
+extern int ezal_nav_find_paths(
+  struct EZALRuntimeContext* ctx,
+  struct EZALNavGrid* grid,
+  struct EZALNavQuery* queries,
+  int count);
+extern void ezal_nav_clear_cache(struct EZALNavGrid* grid);
+extern void ezal_nav_get_stats(struct EZALNavGrid* grid, struct EZALNavStats* stats);
+extern struct EZALFlowField* ezal_nav_create_flow_field(struct EZALNavGrid* grid);
+extern void ezal_nav_destroy_flow_field(struct EZALFlowField* field);
+extern bool ezal_nav_build_flow_field(struct EZALFlowField* field, int goal_x, int goal_y);
+extern bool ezal_nav_flow_step(struct EZALFlowField* field, int x, int y, struct EZALNavPoint* next);
+extern int ezal_nav_flow_distance(struct EZALFlowField* field, int x, int y);
+
+extern struct EZALArchive* ezal_open_archive(struct EZALRuntimeContext* ctx, const char* filename);
+extern void ezal_close_archive(struct EZALRuntimeContext* ctx, struct EZALArchive* archive);
+extern int ezal_archive_get_count(struct EZALArchive* archive);
+extern const struct EZALPackEntry* ezal_archive_get_entry(struct EZALArchive* archive, int index);
+extern const struct EZALPackEntry* ezal_archive_find(struct EZALArchive* archive, const char* name);
+extern const void* ezal_archive_get_data(struct EZALArchive* archive, const char* name, size_t* size);
+extern ALLEGRO_BITMAP* ezal_archive_load_bitmap(
+  struct EZALRuntimeContext* ctx,
+  struct EZALArchive* archive,
+  const char* name);
+extern ALLEGRO_SAMPLE* ezal_archive_load_sample(
+  struct EZALRuntimeContext* ctx,
+  struct EZALArchive* archive,
+  const char* name);
+
+extern void ezal_log_write(int level, unsigned int category, const char* fmt, ...);
+extern void ezal_log_set_level(int level);
+extern void ezal_log_set_categories(unsigned int categories);
+extern void ezal_log_flush(void);
+extern unsigned int ezal_log_get_dropped_count(void);
+
 #define EZAL_H
 #endif // !EZAL_H
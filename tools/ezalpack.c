@@ -0,0 +1,291 @@
+// EZAL Asset Packer
+// Decodes images and sounds with the Allegro addons once, offline, and
+// writes them into an archive that ezal_open_archive maps at runtime.
+// Images are stored as raw pixels in the chosen pixel format, sounds as
+// PCM in the depth they decode to, anything else is stored as it is.
+// Assets are named by the path given on the command line.
+//
+// usage: ezalpack [-argb] archive.pak file...
+//   -argb  store pixels as ARGB_8888 instead of ABGR_8888_LE (RGBA bytes),
+//          use it when your game runs on Direct3D
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../ezal.h"
+
+struct PackedAsset {
+  const char* filename;
+  struct EZALPackEntry entry;
+};
+
+static const char* image_extensions[] = { ".png", ".jpg", ".jpeg", ".bmp", ".tga", ".pcx", ".webp", 0 };
+static const char* sound_extensions[] = { ".wav", ".ogg", ".flac", ".opus", ".voc", 0 };
+
+static bool has_extension(const char* filename, const char** extensions)
+{
+  const char* dot = strrchr(filename, '.');
+  if (!dot)
+  {
+    return false;
+  }
+  for (int i = 0; extensions[i]; i++)
+  {
+    const char* a = dot;
+    const char* b = extensions[i];
+    while (*a && *b && (*a | 0x20) == *b)
+    {
+      a++;
+      b++;
+    }
+    if (!*a && !*b)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+static int compare_assets(const void* a, const void* b)
+{
+  return strcmp(((const struct PackedAsset*)a)->entry.name, ((const struct PackedAsset*)b)->entry.name);
+}
+
+// pads the file with zeros up to the next multiple of align
+static bool write_padding(FILE* fp, uint64_t* offset, uint64_t align)
+{
+  static const unsigned char zeros[EZAL_PACK_ALIGN] = { 0 };
+  uint64_t padding = (align - *offset % align) % align;
+  if (padding && fwrite(zeros, 1, (size_t)padding, fp) != (size_t)padding)
+  {
+    return false;
+  }
+  *offset += padding;
+  return true;
+}
+
+static bool pack_bitmap(FILE* fp, struct PackedAsset* asset, int format)
+{
+  ALLEGRO_BITMAP* bitmap = al_load_bitmap(asset->filename);
+  if (!bitmap)
+  {
+    fprintf(stderr, "ezalpack: could not load image %s\n", asset->filename);
+    return false;
+  }
+
+  ALLEGRO_LOCKED_REGION* region = al_lock_bitmap(bitmap, format, ALLEGRO_LOCK_READONLY);
+  if (!region)
+  {
+    fprintf(stderr, "ezalpack: could not lock %s\n", asset->filename);
+    al_destroy_bitmap(bitmap);
+    return false;
+  }
+
+  int width = al_get_bitmap_width(bitmap);
+  int height = al_get_bitmap_height(bitmap);
+  size_t row_size = (size_t)width * (size_t)region->pixel_size;
+
+  bool ok = true;
+  for (int row = 0; ok && row < height; row++)
+  {
+    ok = fwrite((const unsigned char*)region->data + row * region->pitch, 1, row_size, fp) == row_size;
+  }
+
+  al_unlock_bitmap(bitmap);
+  al_destroy_bitmap(bitmap);
+
+  asset->entry.type = EZAL_PACK_TYPE_BITMAP;
+  asset->entry.format = (uint32_t)format;
+  asset->entry.a = (uint32_t)width;
+  asset->entry.b = (uint32_t)height;
+  asset->entry.c = (uint32_t)row_size;
+  asset->entry.size = (uint64_t)row_size * (uint64_t)height;
+  return ok;
+}
+
+static bool pack_sample(FILE* fp, struct PackedAsset* asset)
+{
+  ALLEGRO_SAMPLE* sample = al_load_sample(asset->filename);
+  if (!sample)
+  {
+    fprintf(stderr, "ezalpack: could not load sound %s\n", asset->filename);
+    return false;
+  }
+
+  int depth = al_get_sample_depth(sample);
+  int channels = al_get_sample_channels(sample);
+  unsigned int length = al_get_sample_length(sample);
+  size_t size = (size_t)length * al_get_channel_count(channels) * al_get_audio_depth_size(depth);
+
+  bool ok = fwrite(al_get_sample_data(sample), 1, size, fp) == size;
+
+  asset->entry.type = EZAL_PACK_TYPE_SAMPLE;
+  asset->entry.format = (uint32_t)depth;
+  asset->entry.a = al_get_sample_frequency(sample);
+  asset->entry.b = (uint32_t)channels;
+  asset->entry.c = length;
+  asset->entry.size = size;
+
+  al_destroy_sample(sample);
+  return ok;
+}
+
+static bool pack_data(FILE* fp, struct PackedAsset* asset)
+{
+  FILE* in = fopen(asset->filename, "rb");
+  if (!in)
+  {
+    fprintf(stderr, "ezalpack: could not open %s\n", asset->filename);
+    return false;
+  }
+
+  unsigned char buffer[65536];
+  size_t count;
+  bool ok = true;
+  asset->entry.size = 0;
+  while (ok && (count = fread(buffer, 1, sizeof(buffer), in)) > 0)
+  {
+    ok = fwrite(buffer, 1, count, fp) == count;
+    asset->entry.size += count;
+  }
+  ok = ok && !ferror(in);
+  fclose(in);
+
+  asset->entry.type = EZAL_PACK_TYPE_DATA;
+  return ok;
+}
+
+int main(int argc, char* argv[])
+{
+  int format = ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE;
+  int first = 1;
+  if (first < argc && !strcmp(argv[first], "-argb"))
+  {
+    format = ALLEGRO_PIXEL_FORMAT_ARGB_8888;
+    first++;
+  }
+
+  if (argc - first < 2)
+  {
+    fprintf(stderr, "usage: ezalpack [-argb] archive.pak file...\n");
+    return EXIT_FAILURE;
+  }
+
+  const char* output = argv[first];
+  int count = argc - first - 1;
+
+  struct PackedAsset* assets = (struct PackedAsset*)calloc((size_t)count, sizeof(struct PackedAsset));
+  if (!assets)
+  {
+    fprintf(stderr, "ezalpack: out of memory\n");
+    return EXIT_FAILURE;
+  }
+
+  for (int i = 0; i < count; i++)
+  {
+    assets[i].filename = argv[first + 1 + i];
+    if (strlen(assets[i].filename) >= EZAL_PACK_NAME_MAX)
+    {
+      fprintf(stderr, "ezalpack: %s is longer than %d characters\n", assets[i].filename, EZAL_PACK_NAME_MAX - 1);
+      return EXIT_FAILURE;
+    }
+    strcpy(assets[i].entry.name, assets[i].filename);
+  }
+
+  qsort(assets, (size_t)count, sizeof(struct PackedAsset), &compare_assets);
+  for (int i = 1; i < count; i++)
+  {
+    if (!strcmp(assets[i - 1].entry.name, assets[i].entry.name))
+    {
+      fprintf(stderr, "ezalpack: %s is listed twice\n", assets[i].entry.name);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (!al_init() || !al_init_image_addon())
+  {
+    fprintf(stderr, "ezalpack: could not initialize allegro\n");
+    return EXIT_FAILURE;
+  }
+
+  // loading sounds does not need an audio device, build machines often
+  // have none
+  if (!al_install_audio() || !al_init_acodec_addon())
+  {
+    fprintf(stderr, "ezalpack: audio is not available, sounds may fail to load\n");
+  }
+
+  // decode into memory bitmaps, no display needed
+  al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+
+  FILE* fp = fopen(output, "wb");
+  if (!fp)
+  {
+    fprintf(stderr, "ezalpack: could not create %s\n", output);
+    return EXIT_FAILURE;
+  }
+
+  struct EZALPackHeader header;
+  memset(&header, 0, sizeof(header));
+  uint64_t offset = sizeof(header);
+  bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+
+  for (int i = 0; ok && i < count; i++)
+  {
+    struct PackedAsset* asset = &assets[i];
+    ok = write_padding(fp, &offset, EZAL_PACK_ALIGN);
+    if (!ok)
+    {
+      break;
+    }
+
+    asset->entry.offset = offset;
+    if (has_extension(asset->filename, image_extensions))
+    {
+      ok = pack_bitmap(fp, asset, format);
+    }
+    else if (has_extension(asset->filename, sound_extensions))
+    {
+      ok = pack_sample(fp, asset);
+    }
+    else
+    {
+      ok = pack_data(fp, asset);
+    }
+    offset += asset->entry.size;
+
+    if (ok)
+    {
+      printf("%-*s %8llu bytes\n", EZAL_PACK_NAME_MAX, asset->entry.name, (unsigned long long)asset->entry.size);
+    }
+  }
+
+  ok = ok && write_padding(fp, &offset, 8);
+
+  memcpy(header.magic, EZAL_PACK_MAGIC, sizeof(header.magic));
+  header.version = EZAL_PACK_VERSION;
+  header.byte_order = EZAL_PACK_BYTE_ORDER;
+  header.entry_count = (uint32_t)count;
+  header.toc_offset = offset;
+  header.size = offset + (uint64_t)count * sizeof(struct EZALPackEntry);
+
+  for (int i = 0; ok && i < count; i++)
+  {
+    ok = fwrite(&assets[i].entry, sizeof(struct EZALPackEntry), 1, fp) == 1;
+  }
+
+  ok = ok && fseek(fp, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, fp) == 1;
+  ok = fclose(fp) == 0 && ok;
+  free(assets);
+
+  if (!ok)
+  {
+    fprintf(stderr, "ezalpack: writing %s failed\n", output);
+    remove(output);
+    return EXIT_FAILURE;
+  }
+
+  printf("%s: %d assets, %llu bytes\n", output, count, (unsigned long long)header.size);
+  return EXIT_SUCCESS;
+}
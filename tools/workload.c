@@ -0,0 +1,444 @@
+// EZAL PGO Workload
+// Runs the ezal main loop headless for a fixed number of frames,
+// exercising the same paths a game does every frame (drawing, timers,
+// logging and pathfinding). The pgo target in the Makefile runs this
+// against an instrumented libezal.a to collect the profile used for the
+// optimized build.
+//
+// With -nav it instead moves 1000 agents around a 256x256 grid and
+// reports how long pathfinding takes per frame. Every agent gets a path
+// on the first frame, after that agents follow their paths and search
+// again when they arrive, when their path gets blocked and every
+// NAV_BENCH_REPATH frames. It also checks that blocking the corner of a
+// cached diagonal step makes the next search walk around it.
+//
+// usage: workload [-nav] [frames]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../ezal.h"
+
+#define WORKLOAD_SPRITES 64
+#define WORKLOAD_SPRITE_SIZE 32
+#define WORKLOAD_GRID_SIZE 64
+#define WORKLOAD_AGENTS 32
+
+#define NAV_BENCH_SIZE 256
+#define NAV_BENCH_AGENTS 1000
+#define NAV_BENCH_PATH 2048
+#define NAV_BENCH_REPATH 30
+#define NAV_BENCH_DOOR_INTERVAL 120
+
+struct WorkloadData {
+  ALLEGRO_BITMAP* sprite;
+  int frames;
+  int frame;
+  unsigned int timers[16];
+  int timer_fired;
+  struct EZALNavGrid* grid;
+  struct EZALFlowField* field;
+  struct EZALNavQuery queries[WORKLOAD_AGENTS];
+  struct EZALNavPoint paths[WORKLOAD_AGENTS][WORKLOAD_GRID_SIZE * 4];
+};
+
+static struct WorkloadData workload;
+
+struct NavAgent {
+  int x;
+  int y;
+  int goal_x;
+  int goal_y;
+  int step;
+  int length;
+  struct EZALNavPoint* path;
+};
+
+struct NavBenchData {
+  struct EZALNavGrid* grid;
+  struct NavAgent* agents;
+  struct EZALNavPoint* paths;
+  struct EZALNavQuery* queries;
+  int* asking;
+  unsigned int seed;
+  int frames;
+  int frame;
+  double first_ms;
+  double total_ms;
+  double max_ms;
+  unsigned long long searched;
+  bool corner_ok;
+};
+
+static struct NavBenchData bench;
+
+static int nav_bench_random(int range)
+{
+  bench.seed = bench.seed * 1103515245u + 12345u;
+  return (int)((bench.seed >> 8) % (unsigned int)range);
+}
+
+static void nav_bench_random_cell(int* x, int* y)
+{
+  do
+  {
+    *x = nav_bench_random(NAV_BENCH_SIZE);
+    *y = nav_bench_random(NAV_BENCH_SIZE);
+  } while (ezal_nav_get_cost(bench.grid, *x, *y) == EZAL_NAV_BLOCKED);
+}
+
+EZAL_TIMER_FN(workload_timer)
+{
+  struct WorkloadData* wl = (struct WorkloadData*)data;
+  wl->timer_fired++;
+}
+
+EZAL_FN(workload_create)
+{
+  workload.sprite = ezal_create_bitmap(ctx, WORKLOAD_SPRITE_SIZE, WORKLOAD_SPRITE_SIZE);
+  if (!workload.sprite)
+  {
+    fprintf(stderr, "workload: could not create the sprite bitmap\n");
+    ezal_stop(ctx);
+    return;
+  }
+
+  ALLEGRO_BITMAP* target = al_get_target_bitmap();
+  al_set_target_bitmap(workload.sprite);
+  al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+  al_draw_filled_circle(
+    WORKLOAD_SPRITE_SIZE * 0.5f,
+    WORKLOAD_SPRITE_SIZE * 0.5f,
+    WORKLOAD_SPRITE_SIZE * 0.5f - 1.0f,
+    al_map_rgba(200, 120, 40, 200));
+  al_set_target_bitmap(target);
+
+  ezal_timer_every(ctx, 1, 1, &workload_timer, &workload);
+
+  workload.grid = ezal_nav_create_grid(ctx, WORKLOAD_GRID_SIZE, WORKLOAD_GRID_SIZE, true);
+  if (workload.grid)
+  {
+    for (int i = 4; i < WORKLOAD_GRID_SIZE - 4; i += 8)
+    {
+      ezal_nav_fill_cost(workload.grid, i, 0, 2, WORKLOAD_GRID_SIZE - 6, EZAL_NAV_BLOCKED);
+    }
+    workload.field = ezal_nav_create_flow_field(workload.grid);
+  }
+}
+
+EZAL_FN(workload_destroy)
+{
+  ezal_destroy_bitmap(ctx, workload.sprite);
+  workload.sprite = 0;
+  ezal_nav_destroy_grid(ctx, workload.grid);
+  workload.grid = 0;
+  workload.field = 0;
+}
+
+EZAL_FN(workload_update)
+{
+  workload.frame++;
+  if (workload.frame >= workload.frames)
+  {
+    ezal_stop(ctx);
+    return;
+  }
+
+  // short lived timers, half of them cancelled before they fire
+  int slot = workload.frame % 16;
+  if (workload.timers[slot])
+  {
+    ezal_timer_cancel(ctx, workload.timers[slot]);
+  }
+  workload.timers[slot] = ezal_timer_after(ctx, (unsigned int)(1 + (workload.frame * 7) % 300), &workload_timer, &workload);
+  if (slot & 1)
+  {
+    ezal_timer_cancel(ctx, workload.timers[slot]);
+    workload.timers[slot] = 0;
+  }
+
+  // a wall moving around keeps invalidating cached paths
+  if (workload.grid)
+  {
+    int wall = (workload.frame / 4) % WORKLOAD_GRID_SIZE;
+    ezal_nav_fill_cost(workload.grid, wall, WORKLOAD_GRID_SIZE - 3, 1, 3, EZAL_NAV_BLOCKED);
+    ezal_nav_fill_cost(workload.grid, (wall + WORKLOAD_GRID_SIZE - 1) % WORKLOAD_GRID_SIZE, WORKLOAD_GRID_SIZE - 3, 1, 3, 1 + wall % 3);
+
+    for (int i = 0; i < WORKLOAD_AGENTS; i++)
+    {
+      struct EZALNavQuery* query = &workload.queries[i];
+      query->start_x = (i * 13 + workload.frame) % WORKLOAD_GRID_SIZE;
+      query->start_y = (i * 29) % WORKLOAD_GRID_SIZE;
+      query->goal_x = (i * 7) % WORKLOAD_GRID_SIZE;
+      query->goal_y = WORKLOAD_GRID_SIZE - 1 - (i % 4);
+      query->path = workload.paths[i];
+      query->max_length = WORKLOAD_GRID_SIZE * 4;
+    }
+    ezal_nav_find_paths(ctx, workload.grid, workload.queries, WORKLOAD_AGENTS);
+
+    if (workload.field && ezal_nav_build_flow_field(workload.field, workload.frame % WORKLOAD_GRID_SIZE, WORKLOAD_GRID_SIZE - 1))
+    {
+      struct EZALNavPoint next;
+      for (int i = 0; i < WORKLOAD_AGENTS; i++)
+      {
+        ezal_nav_flow_step(workload.field, workload.queries[i].start_x, workload.queries[i].start_y, &next);
+      }
+    }
+  }
+
+  // disabled log statements cost a branch and nothing more
+  EZAL_LOG(EZAL_LOG_LEVEL_TRACE, EZAL_LOG_CATEGORY_USER, "frame %d", workload.frame);
+}
+
+EZAL_FN(workload_render)
+{
+  if (!workload.sprite)
+  {
+    return;
+  }
+
+  int w = ctx->cfg->logical_width;
+  int h = ctx->cfg->logical_height;
+  int frame = workload.frame;
+
+  ezal_draw_filled_rectangle(ctx, 0, 0, (float)w, 24.0f, al_map_rgb(30, 30, 60));
+
+  for (int i = 0; i < WORKLOAD_SPRITES; i++)
+  {
+    float x = (float)((i * 37 + frame * 3) % (w - WORKLOAD_SPRITE_SIZE));
+    float y = (float)((i * 53 + frame * 2) % (h - WORKLOAD_SPRITE_SIZE));
+    switch (i & 3)
+    {
+      case 0:
+        ezal_draw_bitmap(ctx, workload.sprite, x, y, 0);
+        break;
+      case 1:
+        ezal_draw_tinted_bitmap(ctx, workload.sprite, al_map_rgba(255, 255, 255, 128), x, y, 0);
+        break;
+      case 2:
+        ezal_draw_bitmap_region(ctx, workload.sprite,
+          0, 0, WORKLOAD_SPRITE_SIZE * 0.5f, WORKLOAD_SPRITE_SIZE * 0.5f,
+          x, y, 0);
+        break;
+      default:
+        ezal_draw_scaled_bitmap(ctx, workload.sprite,
+          0, 0, WORKLOAD_SPRITE_SIZE, WORKLOAD_SPRITE_SIZE,
+          x, y, WORKLOAD_SPRITE_SIZE * 1.5f, WORKLOAD_SPRITE_SIZE * 1.5f, 0);
+        break;
+    }
+  }
+}
+
+// a cached diagonal step must be dropped when one of the corner cells it
+// passes gets blocked, even when that cell is in another region
+static bool nav_bench_check_corner(struct EZALRuntimeContext* ctx)
+{
+  struct EZALNavGrid* grid = ezal_nav_create_grid(ctx, 32, 32, true);
+  if (!grid)
+  {
+    return false;
+  }
+  struct EZALNavPoint path[8];
+  int before = ezal_nav_find_path(grid, 15, 15, 16, 16, path, 8);
+  ezal_nav_set_cost(grid, 16, 15, EZAL_NAV_BLOCKED);
+  int after = ezal_nav_find_path(grid, 15, 15, 16, 16, path, 8);
+  bool ok = before == 1 && after == 2 && path[0].x == 15 && path[0].y == 16;
+  ezal_nav_destroy_grid(ctx, grid);
+  return ok;
+}
+
+EZAL_FN(nav_bench_create)
+{
+  bench.corner_ok = nav_bench_check_corner(ctx);
+  bench.seed = 1;
+  bench.grid = ezal_nav_create_grid(ctx, NAV_BENCH_SIZE, NAV_BENCH_SIZE, true);
+  bench.agents = (struct NavAgent*)calloc(NAV_BENCH_AGENTS, sizeof(struct NavAgent));
+  bench.paths = (struct EZALNavPoint*)malloc((size_t)NAV_BENCH_AGENTS * NAV_BENCH_PATH * sizeof(struct EZALNavPoint));
+  bench.queries = (struct EZALNavQuery*)calloc(NAV_BENCH_AGENTS, sizeof(struct EZALNavQuery));
+  bench.asking = (int*)calloc(NAV_BENCH_AGENTS, sizeof(int));
+  if (!bench.grid || !bench.agents || !bench.paths || !bench.queries || !bench.asking)
+  {
+    fprintf(stderr, "workload: could not set up the navigation benchmark\n");
+    ezal_stop(ctx);
+    return;
+  }
+
+  // scattered buildings and patches of mud
+  for (int i = 0; i < 300; i++)
+  {
+    int x = nav_bench_random(NAV_BENCH_SIZE);
+    int y = nav_bench_random(NAV_BENCH_SIZE);
+    ezal_nav_fill_cost(bench.grid, x, y, 2 + nav_bench_random(12), 2 + nav_bench_random(12), EZAL_NAV_BLOCKED);
+  }
+  for (int i = 0; i < 200; i++)
+  {
+    ezal_nav_fill_cost(bench.grid, nav_bench_random(NAV_BENCH_SIZE), nav_bench_random(NAV_BENCH_SIZE), 6, 6, 3);
+  }
+
+  // a wall down the middle of the map with a door that opens and closes
+  ezal_nav_fill_cost(bench.grid, NAV_BENCH_SIZE / 2, 0, 1, NAV_BENCH_SIZE, EZAL_NAV_BLOCKED);
+
+  for (int i = 0; i < NAV_BENCH_AGENTS; i++)
+  {
+    struct NavAgent* agent = &bench.agents[i];
+    agent->path = bench.paths + (size_t)i * NAV_BENCH_PATH;
+    nav_bench_random_cell(&agent->x, &agent->y);
+    nav_bench_random_cell(&agent->goal_x, &agent->goal_y);
+  }
+}
+
+EZAL_FN(nav_bench_destroy)
+{
+  ezal_nav_destroy_grid(ctx, bench.grid);
+  free(bench.agents);
+  free(bench.paths);
+  free(bench.queries);
+  free(bench.asking);
+  bench.grid = 0;
+}
+
+EZAL_FN(nav_bench_update)
+{
+  if (bench.frame >= bench.frames)
+  {
+    ezal_stop(ctx);
+    return;
+  }
+
+  if (bench.frame % NAV_BENCH_DOOR_INTERVAL == 0)
+  {
+    bool closed = (bench.frame / NAV_BENCH_DOOR_INTERVAL) & 1;
+    ezal_nav_fill_cost(bench.grid, NAV_BENCH_SIZE / 2, NAV_BENCH_SIZE / 2 - 8, 1, 16, closed ? EZAL_NAV_BLOCKED : 1);
+  }
+
+  int count = 0;
+  for (int i = 0; i < NAV_BENCH_AGENTS; i++)
+  {
+    struct NavAgent* agent = &bench.agents[i];
+    bool ask = agent->step >= agent->length || (bench.frame + i) % NAV_BENCH_REPATH == 0;
+    if (!ask)
+    {
+      struct EZALNavPoint* next = &agent->path[agent->step];
+      if (ezal_nav_get_cost(bench.grid, next->x, next->y) == EZAL_NAV_BLOCKED)
+      {
+        ask = true;
+      }
+      else
+      {
+        agent->x = next->x;
+        agent->y = next->y;
+        agent->step++;
+      }
+    }
+    if (!ask)
+    {
+      continue;
+    }
+
+    if ((agent->x == agent->goal_x && agent->y == agent->goal_y) || agent->length < 0)
+    {
+      nav_bench_random_cell(&agent->goal_x, &agent->goal_y);
+    }
+
+    struct EZALNavQuery* query = &bench.queries[count];
+    query->start_x = agent->x;
+    query->start_y = agent->y;
+    query->goal_x = agent->goal_x;
+    query->goal_y = agent->goal_y;
+    query->path = agent->path;
+    query->max_length = NAV_BENCH_PATH;
+    bench.asking[count++] = i;
+  }
+
+  double start = al_get_time();
+  if (count)
+  {
+    ezal_nav_find_paths(ctx, bench.grid, bench.queries, count);
+  }
+  double ms = (al_get_time() - start) * 1000.0;
+
+  for (int i = 0; i < count; i++)
+  {
+    struct NavAgent* agent = &bench.agents[bench.asking[i]];
+    int length = bench.queries[i].length;
+    agent->length = length > NAV_BENCH_PATH ? NAV_BENCH_PATH : length;
+    agent->step = 0;
+  }
+
+  if (bench.frame == 0)
+  {
+    bench.first_ms = ms;
+  }
+  else
+  {
+    bench.total_ms += ms;
+    bench.searched += (unsigned long long)count;
+    if (ms > bench.max_ms)
+    {
+      bench.max_ms = ms;
+    }
+  }
+  bench.frame++;
+}
+
+EZAL_FN(nav_bench_render)
+{
+}
+
+int main(int argc, char* argv[])
+{
+  bool nav = argc > 1 && !strcmp(argv[1], "-nav");
+  if (nav)
+  {
+    argc--;
+    argv++;
+  }
+
+  workload.frames = argc > 1 ? atoi(argv[1]) : 2000;
+  if (workload.frames < 1)
+  {
+    workload.frames = 1;
+  }
+  bench.frames = workload.frames;
+
+  struct EZALConfig cfg;
+  ezal_use_config_defaults(&cfg);
+  cfg.headless = true;
+  cfg.auto_scale = true;
+  cfg.logical_width = 320;
+  cfg.logical_height = 240;
+  cfg.enable_audio = false;
+  cfg.frame_rate = 1000;
+  cfg.log_level = EZAL_LOG_LEVEL_WARN;
+
+  if (nav)
+  {
+    int result = ezal_start(
+      "EZAL Navigation Benchmark",
+      &nav_bench_create,
+      &nav_bench_destroy,
+      &nav_bench_update,
+      &nav_bench_render,
+      &cfg);
+
+    int frames = bench.frame > 1 ? bench.frame - 1 : 1;
+    printf("nav: %d agents on %dx%d, first frame %.2f ms for %d paths\n",
+      NAV_BENCH_AGENTS, NAV_BENCH_SIZE, NAV_BENCH_SIZE, bench.first_ms, NAV_BENCH_AGENTS);
+    printf("nav: then %.2f ms per frame on average (%.1f paths), %.2f ms at most, over %d frames\n",
+      bench.total_ms / frames, (double)bench.searched / frames, bench.max_ms, frames);
+    printf("nav: blocked corner check %s\n", bench.corner_ok ? "passed" : "FAILED");
+    return result ? result : !bench.corner_ok;
+  }
+
+  int result = ezal_start(
+    "EZAL PGO Workload",
+    &workload_create,
+    &workload_destroy,
+    &workload_update,
+    &workload_render,
+    &cfg);
+
+  printf("workload: %d frames, %d timer callbacks\n", workload.frame, workload.timer_fired);
+  return result;
+}